@@ -0,0 +1,248 @@
+#include <algorithm>
+#include "BatchEngine.hpp"
+#include "CpuFeatures.hpp"
+#include "Parallel.hpp"
+
+#ifdef __SSE2__
+#include <immintrin.h>
+#define BATCH_X86
+#endif
+
+/** The number of inputs each thread takes at a time */
+constexpr std::size_t BATCH_CHUNK = 1024;
+
+/** The smallest tape window of a lane */
+constexpr std::uint32_t MIN_WINDOW = 256;
+
+std::vector<std::uint32_t> packTransitions(const Program& program)
+{
+    std::vector<std::uint32_t> packed;
+    if (program.states() > MAX_BATCH_STATES)
+        return packed;
+    packed.resize(program.states() * 256);
+    for (std::uint32_t s = 0; s < program.states(); ++s) {
+        for (int cell = 0; cell < 256; ++cell) {
+            const Transition& t = program.at(s, program.column(cell));
+            packed[s * 256 + cell] = (t.next == NO_STATE) ? UINT32_MAX :
+                t.next << 10 | ((cell & t.keep) | t.write) << 2 |
+                (t.shift + 1);
+        }
+    }
+    return packed;
+}
+
+BatchEngine::BatchEngine(const Program& program,
+                         const std::vector<std::uint32_t>& packed,
+                         const RunLimits& limits,
+                         const std::vector<std::string>& inputs,
+                         std::vector<RunResult>& results, std::size_t begin,
+                         std::size_t end, std::uint32_t window) :
+    program_(program), packed_(packed), limits_(limits), inputs_(inputs),
+    results_(results), next_(begin), end_(end), window_(window),
+    stepLimit_((std::uint32_t)std::min<std::uint64_t>(limits.steps,
+                                                      UINT32_MAX)),
+    cells_(BATCH_LANES * window), running_(0)
+{
+    for (unsigned lane = 0; lane < BATCH_LANES; ++lane)
+        base_[lane] = lane * window;
+}
+
+void BatchEngine::refill(unsigned lane)
+{
+    state_[lane] = 0;
+    steps_[lane] = 0;
+    head_[lane] = window_ / 2;
+    if (next_ == end_) {
+        active_[lane] = 0;
+        return;
+    }
+    std::size_t job = next_++;
+    const std::string& input = inputs_[job];
+    if (input.size() * 2 > window_) {
+        deferred_.push_back(job);
+        refill(lane);
+        return;
+    }
+    std::uint32_t* tape = &cells_[base_[lane]];
+    std::fill(tape, tape + window_, 0);
+    head_[lane] = (window_ - input.size()) / 2;
+    for (std::size_t i = 0; i < input.size(); ++i)
+        tape[head_[lane] + i] = Program::encode(input[i]);
+    job_[lane] = job;
+    active_[lane] = -1;
+    ++running_;
+}
+
+void BatchEngine::retire(unsigned lane, Outcome outcome)
+{
+    const std::uint32_t* tape = &cells_[base_[lane]];
+    std::uint32_t begin = 0, end = window_;
+    while (begin < end && !tape[begin])
+        ++begin;
+    while (end > begin && !tape[end - 1])
+        --end;
+    RunResult& result = results_[job_[lane]];
+    result.outcome = outcome;
+    result.steps = steps_[lane];
+    result.state = program_.label(state_[lane]);
+    result.tape.resize(end - begin);
+    for (std::uint32_t i = begin; i < end; ++i)
+        result.tape[i - begin] = Program::decode(tape[i]);
+    --running_;
+    refill(lane);
+}
+
+void BatchEngine::defer(unsigned lane)
+{
+    deferred_.push_back(job_[lane]);
+    --running_;
+    refill(lane);
+}
+
+#ifdef BATCH_X86
+
+/** The number of AVX2 registers each lane register is split over */
+constexpr unsigned GROUPS = BATCH_LANES / 8;
+
+__attribute__((target("avx2")))
+void BatchEngine::runLanes()
+{
+    const int* table = (const int*)packed_.data();
+    const int* cells = (const int*)cells_.data();
+    const __m256i none = _mm256_set1_epi32(-1);
+    const __m256i one = _mm256_set1_epi32(1);
+    const __m256i three = _mm256_set1_epi32(3);
+    const __m256i limit = _mm256_set1_epi32(stepLimit_);
+    const __m256i last = _mm256_set1_epi32(window_ - 1);
+    const __m256i zero = _mm256_setzero_si256();
+    alignas(32) std::uint32_t head[BATCH_LANES], word[BATCH_LANES];
+    __m256i base[GROUPS], state[GROUPS], pos[GROUPS], steps[GROUPS];
+    __m256i active[GROUPS];
+    for (unsigned g = 0; g < GROUPS; ++g)
+        base[g] = _mm256_load_si256((const __m256i*)base_ + g);
+
+    while (running_) {
+        for (unsigned g = 0; g < GROUPS; ++g) {
+            state[g] = _mm256_load_si256((const __m256i*)state_ + g);
+            pos[g] = _mm256_load_si256((const __m256i*)head_ + g);
+            steps[g] = _mm256_load_si256((const __m256i*)steps_ + g);
+            active[g] = _mm256_load_si256((const __m256i*)active_ + g);
+        }
+        // Bit n is set if lane n stopped, and bit BATCH_LANES + n if it
+        // reached the edge of its window
+        std::uint64_t stopped = 0;
+        do {
+            // The groups are independent, so their gathers overlap
+            __m256i t[GROUPS];
+            for (unsigned g = 0; g < GROUPS; ++g) {
+                __m256i addr = _mm256_add_epi32(base[g], pos[g]);
+                __m256i cell = _mm256_i32gather_epi32(cells, addr, 4);
+                t[g] = _mm256_i32gather_epi32(table, _mm256_or_si256(
+                    _mm256_slli_epi32(state[g], 8), cell), 4);
+                _mm256_store_si256((__m256i*)head + g, addr);
+                _mm256_store_si256((__m256i*)word + g, t[g]);
+
+                // Lanes at the step limit stop before looking at the
+                // transition, like Execution::run()
+                __m256i stop = _mm256_and_si256(active[g], _mm256_or_si256(
+                    _mm256_cmpeq_epi32(t[g], none),
+                    _mm256_cmpeq_epi32(steps[g], limit)));
+                stopped |= (std::uint64_t)_mm256_movemask_ps(
+                    _mm256_castsi256_ps(stop)) << (g * 8);
+            }
+            if (stopped)
+                break;
+
+            // There is no byte scatter, so the writes are done one by one
+            for (unsigned lane = 0; lane < BATCH_LANES; ++lane) {
+                if (active_[lane])
+                    cells_[head[lane]] = (word[lane] >> 2) & 0xFF;
+            }
+
+            for (unsigned g = 0; g < GROUPS; ++g) {
+                // The low two bits hold the shift plus one
+                __m256i shift = _mm256_sub_epi32(
+                    _mm256_and_si256(t[g], three), one);
+                pos[g] = _mm256_add_epi32(pos[g],
+                                          _mm256_and_si256(active[g], shift));
+                state[g] = _mm256_blendv_epi8(
+                    state[g], _mm256_srli_epi32(t[g], 10), active[g]);
+                steps[g] = _mm256_sub_epi32(steps[g], active[g]);
+
+                __m256i edge = _mm256_and_si256(active[g], _mm256_or_si256(
+                    _mm256_cmpeq_epi32(pos[g], zero),
+                    _mm256_cmpeq_epi32(pos[g], last)));
+                stopped |= (std::uint64_t)_mm256_movemask_ps(
+                    _mm256_castsi256_ps(edge)) << (BATCH_LANES + g * 8);
+            }
+        } while (!stopped);
+
+        for (unsigned g = 0; g < GROUPS; ++g) {
+            _mm256_store_si256((__m256i*)state_ + g, state[g]);
+            _mm256_store_si256((__m256i*)head_ + g, pos[g]);
+            _mm256_store_si256((__m256i*)steps_ + g, steps[g]);
+        }
+        for (unsigned lane = 0; lane < BATCH_LANES; ++lane) {
+            if ((stopped >> (BATCH_LANES + lane)) & 1)
+                defer(lane);
+            else if (!((stopped >> lane) & 1))
+                continue;
+            else if (steps_[lane] == stepLimit_) {
+                if (stepLimit_ < limits_.steps)
+                    defer(lane);
+                else
+                    retire(lane, Outcome::StepLimit);
+            } else {
+                retire(lane, program_.final(state_[lane]) ? Outcome::Accepted
+                                                          : Outcome::Jammed);
+            }
+        }
+    }
+}
+
+#endif /* BATCH_X86 */
+
+void BatchEngine::run()
+{
+    bool lanes = false;
+#ifdef BATCH_X86
+    lanes = hasAvx2() && window_ >= MIN_WINDOW && !packed_.empty();
+#endif /* BATCH_X86 */
+    if (lanes) {
+        for (unsigned lane = 0; lane < BATCH_LANES; ++lane)
+            refill(lane);
+        runLanes();
+    } else {
+        for (; next_ < end_; ++next_)
+            deferred_.push_back(next_);
+    }
+    for (std::size_t job : deferred_)
+        results_[job] = runProgram(program_, inputs_[job], limits_);
+}
+
+std::vector<RunResult> runBatch(const Program& program,
+                                const std::vector<std::string>& inputs,
+                                const RunLimits& limits, unsigned threads)
+{
+    std::vector<RunResult> results(inputs.size());
+    std::vector<std::uint32_t> packed = packTransitions(program);
+    std::size_t chunks = (inputs.size() + BATCH_CHUNK - 1) / BATCH_CHUNK;
+    parallelFor(chunks, [&](std::size_t chunk) {
+        std::size_t begin = chunk * BATCH_CHUNK;
+        std::size_t end = std::min(inputs.size(), begin + BATCH_CHUNK);
+        std::size_t longest = 0;
+        for (std::size_t i = begin; i < end; ++i)
+            longest = std::max(longest, inputs[i].size());
+        // Lanes never touch more cells than their window, so keeping the
+        // window well below the cell limit means no lane finishes a run
+        // that would have run out of memory on a FlatTape
+        std::size_t window = std::max<std::size_t>(MIN_WINDOW,
+                                                   4 * longest + 64);
+        window = (window + 63) & ~(std::size_t)63;
+        if (window > limits.cells / 16 || window > UINT32_MAX / BATCH_LANES)
+            window = 0; // Run everything on an Execution
+        BatchEngine(program, packed, limits, inputs, results, begin, end,
+                    window).run();
+    }, threads);
+    return results;
+}
@@ -0,0 +1,132 @@
+#ifndef BATCH_ENGINE_HPP
+#define BATCH_ENGINE_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Runner.hpp"
+
+/** The number of configurations a BatchEngine advances in lockstep: four
+ * AVX2 registers of eight 32-bit lanes, so that the latency of one
+ * register's gathers is hidden behind the others
+ */
+constexpr unsigned BATCH_LANES = 32;
+
+/** The largest program (in states) a BatchEngine runs in lanes, so that its
+ * packed table (@see packTransitions()) fits in the cache
+ */
+constexpr std::uint32_t MAX_BATCH_STATES = 4096;
+
+/** Packs the transitions of a program into one 32-bit word per state and
+ * encoded cell, indexed [state * 256 + cell], so that a lane needs a single
+ * gather per step. A word holds the next state above bit 10, the symbol to
+ * write in bits 2-9 and the shift plus one in bits 0-1, or is all ones if
+ * there is no transition
+ * @return The packed table, or an empty table if the program has more than
+ * MAX_BATCH_STATES states
+ */
+std::vector<std::uint32_t> packTransitions(const Program& program);
+
+/** @class BatchEngine
+ * Runs one compiled program on a range of inputs, advancing BATCH_LANES
+ * configurations at a time with AVX2. Each lane has its own small tape
+ * window, and the lanes' states, head positions and step counts are stored
+ * as structure-of-arrays so that a step is two gathers (the cell and its
+ * packed transition) and a few vector operations. Lanes that stop are
+ * retired and refilled with the next input.
+ *
+ * Inputs whose runs leave their tape window or outlast the 32-bit step
+ * counters are deferred and run again from the start on an Execution, as
+ * are all inputs on CPUs without AVX2, so the results are always exactly
+ * those of runProgram()
+ */
+class BatchEngine {
+    const Program& program_;
+
+    /** @see packTransitions() */
+    const std::vector<std::uint32_t>& packed_;
+
+    RunLimits limits_;
+    const std::vector<std::string>& inputs_;
+
+    /** The results, indexed like inputs_ */
+    std::vector<RunResult>& results_;
+
+    /** The next input to load and the end of the range of inputs */
+    std::size_t next_, end_;
+
+    /** The number of cells in each lane's tape */
+    std::uint32_t window_;
+
+    /** The step count at which lanes stop */
+    std::uint32_t stepLimit_;
+
+    /** The lanes' tapes, one window after the other. Cells are widened to
+     * 32 bits so that gathering a cell never overlaps the byte just written
+     * to a neighbouring cell, which would stall on store forwarding
+     */
+    std::vector<std::uint32_t> cells_;
+
+    /** The registers of each lane */
+    alignas(32) std::uint32_t state_[BATCH_LANES];
+    alignas(32) std::uint32_t head_[BATCH_LANES];
+    alignas(32) std::uint32_t steps_[BATCH_LANES];
+
+    /** The offset of each lane's window in cells_ */
+    alignas(32) std::uint32_t base_[BATCH_LANES];
+
+    /** All ones for lanes running an input, zero for idle lanes */
+    alignas(32) std::int32_t active_[BATCH_LANES];
+
+    /** The input each lane is running */
+    std::size_t job_[BATCH_LANES];
+
+    /** The number of active lanes */
+    unsigned running_;
+
+    /** Inputs to run on an Execution instead */
+    std::vector<std::size_t> deferred_;
+
+    /** Loads the next input into a lane, or idles the lane if there is
+     * none
+     */
+    void refill(unsigned lane);
+
+    /** Records the result of a lane and refills it */
+    void retire(unsigned lane, Outcome outcome);
+
+    /** Defers the input of a lane and refills it */
+    void defer(unsigned lane);
+
+    /** Advances the lanes with AVX2 until every input is retired or
+     * deferred
+     */
+    void runLanes();
+
+public:
+    /** @param window The number of cells of each lane's tape. Inputs longer
+     * than half of it are deferred, as is every input if it is less than
+     * 256 or if packed is empty
+     */
+    BatchEngine(const Program& program,
+                const std::vector<std::uint32_t>& packed,
+                const RunLimits& limits,
+                const std::vector<std::string>& inputs,
+                std::vector<RunResult>& results, std::size_t begin,
+                std::size_t end, std::uint32_t window);
+
+    /** Runs every input in the range */
+    void run();
+};
+
+/** Runs program on every input, splitting the inputs over the given number
+ * of threads (@see defaultThreads() if zero), each with its own
+ * BatchEngine
+ * @return The results in the order of the inputs
+ */
+std::vector<RunResult> runBatch(const Program& program,
+                                const std::vector<std::string>& inputs,
+                                const RunLimits& limits,
+                                unsigned threads = 0);
+
+#endif /* BATCH_ENGINE_HPP */
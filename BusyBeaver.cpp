@@ -0,0 +1,290 @@
+#include <algorithm>
+#include "BusyBeaver.hpp"
+#include "Deciders.hpp"
+#include "Engine.hpp"
+#include "Parallel.hpp"
+#include "StateParser.hpp"
+
+/** The number of subtrees per thread to split the enumeration into, so
+ * that uneven subtrees still balance out
+ */
+constexpr std::size_t SUBTREES_PER_THREAD = 64;
+
+Program busyBeaverProgram(unsigned states, unsigned symbols)
+{
+    std::vector<std::string> labels;
+    for (unsigned i = 0; i < states; ++i)
+        labels.emplace_back(1, 'A' + i);
+    labels.emplace_back("Z");
+    std::string alphabet(1, BLANK);
+    for (unsigned i = 1; i < symbols; ++i)
+        alphabet.push_back('0' + i);
+    Program program(labels, alphabet);
+    program.setFinal(states, true);
+    return program;
+}
+
+std::string toCompact(const Program& program)
+{
+    std::string str;
+    for (std::uint32_t s = 0; s < program.states(); ++s) {
+        if (program.label(s) == "Z")
+            continue;
+        if (!str.empty())
+            str.push_back('_');
+        for (std::uint32_t c = 0; c + 1 < program.columns(); ++c) {
+            const Transition& t = program.at(s, c);
+            if (t.next == NO_STATE) {
+                str += "---";
+                continue;
+            }
+            str.push_back('0' + program.column(t.write));
+            str.push_back(t.shift < 0 ? 'L' : 'R');
+            str.push_back(program.label(t.next)[0]);
+        }
+    }
+    return str;
+}
+
+bool fromCompact(const std::string& str, Program& program)
+{
+    std::vector<std::string> rows(1);
+    for (char c : str) {
+        if (c == '_')
+            rows.emplace_back();
+        else
+            rows.back().push_back(c);
+    }
+    unsigned states = rows.size(), symbols = rows[0].size() / 3;
+    if (states > 25 || symbols < 2 || symbols > 10) {
+        err << str << ": Unsupported machine size" << std::endl;
+        return true;
+    }
+    program = busyBeaverProgram(states, symbols);
+    for (unsigned s = 0; s < states; ++s) {
+        const std::string& row = rows[s];
+        if (row.size() != symbols * 3) {
+            err << str << ": Row " << s + 1 << " does not have "
+                << symbols << " transitions" << std::endl;
+            return true;
+        }
+        for (unsigned c = 0; c < symbols; ++c) {
+            const char* def = &row[c * 3];
+            if (def[0] == '-' && def[1] == '-' && def[2] == '-')
+                continue;
+            unsigned write = def[0] - '0', next = def[2] - 'A';
+            if (write >= symbols || (def[1] != 'L' && def[1] != 'R') ||
+                next >= 26)
+            {
+                err << str << ": Invalid transition `"
+                    << row.substr(c * 3, 3) << "'" << std::endl;
+                return true;
+            }
+            Transition& t = program.at(s, c);
+            t.next = std::min(next, states);
+            t.write = Program::encode(program.alphabet()[write]);
+            t.shift = def[1] == 'L' ? -1 : 1;
+        }
+    }
+    return false;
+}
+
+BusyBeaverConfig::BusyBeaverConfig() :
+    states(2), symbols(2), steps(10000), space(10000), depth(30),
+    threads(0) {}
+
+BusyBeaverStats::BusyBeaverStats() :
+    enumerated(0), halted(0), cyclers(0), translated(0), backward(0),
+    malformed(0), maxSteps(0), maxOnes(0) {}
+
+void BusyBeaverStats::merge(const BusyBeaverStats& other)
+{
+    enumerated += other.enumerated;
+    halted += other.halted;
+    cyclers += other.cyclers;
+    translated += other.translated;
+    backward += other.backward;
+    malformed += other.malformed;
+    holdouts.insert(holdouts.end(), other.holdouts.begin(),
+                    other.holdouts.end());
+    if (other.maxSteps > maxSteps) {
+        maxSteps = other.maxSteps;
+        stepsChampion = other.stepsChampion;
+    }
+    if (other.maxOnes > maxOnes) {
+        maxOnes = other.maxOnes;
+        onesChampion = other.onesChampion;
+    }
+}
+
+void BusyBeaverStats::print(std::ostream& os) const
+{
+    os << "Enumerated:         " << enumerated << std::endl
+       << "Halted:             " << halted << std::endl
+       << "Cyclers:            " << cyclers << std::endl
+       << "Translated cyclers: " << translated << std::endl
+       << "Backward reasoning: " << backward << std::endl
+       << "Holdouts:           " << holdouts.size() << std::endl;
+    if (malformed)
+        os << "Malformed:          " << malformed << std::endl;
+    if (halted) {
+        os << "Most steps:         " << maxSteps << " (" << stepsChampion
+           << ")" << std::endl
+           << "Most non-blanks:    " << maxOnes << " (" << onesChampion
+           << ")" << std::endl;
+    }
+}
+
+BusyBeaver::BusyBeaver(const BusyBeaverConfig& config) : config_(config) {}
+
+void BusyBeaver::search(Node& node, Execution& exec, BusyBeaverStats& stats,
+                        std::vector<Node>* children)
+{
+    Program& program = node.program;
+    ++stats.enumerated;
+    Outcome outcome = exec.run(config_.steps - exec.steps());
+    if (outcome != Outcome::Jammed) {
+        if (!decide(program, stats))
+            stats.holdouts.push_back(toCompact(program));
+        return;
+    }
+
+    // The missing transition is where the machine halts; filling it with a
+    // halting transition gives the leaf, every other choice a child
+    std::uint32_t state = exec.state();
+    std::uint8_t read = program.column(exec.tape().head());
+    Transition& t = program.at(state, read);
+    const FlatTape& tape = exec.tape();
+    std::uint64_t ones = !read;
+    for (long pos = tape.left(); pos <= tape.right(); ++pos)
+        ones += tape.at(pos) != 0;
+    if (exec.steps() + 1 > stats.maxSteps || ones > stats.maxOnes) {
+        t.next = config_.states;
+        t.write = Program::encode(program.alphabet()[1]);
+        t.shift = 1;
+    }
+    halted(program, exec.steps() + 1, ones, stats);
+
+    if (node.defined + 1 < config_.states * config_.symbols) {
+        unsigned states = node.states, symbols = node.symbols;
+        FlatTape saved = tape;
+        std::uint64_t steps = exec.steps();
+        ++node.defined;
+        for (unsigned next = 0; next <= states && next < config_.states;
+             ++next)
+        {
+            for (unsigned w = 0; w <= symbols && w < config_.symbols; ++w) {
+                for (int shift : {1, -1}) {
+                    t.next = next;
+                    t.write = Program::encode(program.alphabet()[w]);
+                    t.shift = shift;
+                    node.states = std::max(states, next + 1);
+                    node.symbols = std::max(symbols, w + 1);
+                    if (children) {
+                        children->push_back(node);
+                        Node& child = children->back();
+                        child.tape = saved;
+                        child.state = state;
+                        child.steps = steps;
+                    } else {
+                        exec.resume(saved, state, steps);
+                        search(node, exec, stats, nullptr);
+                    }
+                }
+            }
+        }
+        --node.defined;
+        node.states = states;
+        node.symbols = symbols;
+    }
+    t = Transition();
+}
+
+void BusyBeaver::halted(const Program& program, std::uint64_t steps,
+                        std::uint64_t ones, BusyBeaverStats& stats)
+{
+    ++stats.halted;
+    if (steps > stats.maxSteps || ones > stats.maxOnes) {
+        std::string compact = toCompact(program);
+        if (steps > stats.maxSteps) {
+            stats.maxSteps = steps;
+            stats.stepsChampion = compact;
+        }
+        if (ones > stats.maxOnes) {
+            stats.maxOnes = ones;
+            stats.onesChampion = compact;
+        }
+    }
+}
+
+bool BusyBeaver::decide(const Program& program, BusyBeaverStats& stats)
+{
+    if (decideCycler(program, config_.steps, config_.space))
+        ++stats.cyclers;
+    else if (decideTranslatedCycler(program, config_.steps, config_.space))
+        ++stats.translated;
+    else if (decideBackward(program, config_.depth))
+        ++stats.backward;
+    else
+        return false;
+    return true;
+}
+
+bool BusyBeaver::classify(const Program& program, Execution& exec,
+                          BusyBeaverStats& stats)
+{
+    ++stats.enumerated;
+    exec.reset("");
+    Outcome outcome = exec.run(config_.steps);
+    if (outcome == Outcome::Accepted || outcome == Outcome::Jammed) {
+        // A missing transition counts as a halting transition writing a
+        // non-blank, as in tree normal form
+        const FlatTape& tape = exec.tape();
+        bool missing = outcome == Outcome::Jammed;
+        std::uint64_t ones = missing && !tape.head();
+        for (long pos = tape.left(); pos <= tape.right(); ++pos)
+            ones += tape.at(pos) != 0;
+        halted(program, exec.steps() + missing, ones, stats);
+        return false;
+    }
+    return !decide(program, stats);
+}
+
+BusyBeaverStats BusyBeaver::run()
+{
+    unsigned threads = config_.threads ? config_.threads : defaultThreads();
+    Node root{busyBeaverProgram(config_.states, config_.symbols), 1, 1, 0,
+              FlatTape(config_.space), 0, 0};
+    if (config_.states > 1) {
+        Transition& t = root.program.at(0, 0);
+        t.next = 1;
+        t.write = Program::encode(root.program.alphabet()[1]);
+        t.shift = 1;
+        root.states = root.symbols = 2;
+        root.defined = 1;
+    }
+
+    // Expand the top of the tree breadth-first until there are enough
+    // subtrees to keep every thread busy
+    BusyBeaverStats total;
+    std::vector<Node> level{root}, next;
+    while (!level.empty() && level.size() < threads * SUBTREES_PER_THREAD) {
+        next.clear();
+        for (Node& node : level) {
+            Execution exec(node.program, config_.space);
+            exec.resume(node.tape, node.state, node.steps);
+            search(node, exec, total, &next);
+        }
+        level.swap(next);
+    }
+
+    std::vector<BusyBeaverStats> parts(level.size());
+    parallelFor(level.size(), [&](std::size_t i) {
+        Execution exec(level[i].program, config_.space);
+        exec.resume(level[i].tape, level[i].state, level[i].steps);
+        search(level[i], exec, parts[i], nullptr);
+    }, threads);
+    for (const BusyBeaverStats& part : parts)
+        total.merge(part);
+    return total;
+}
@@ -0,0 +1,148 @@
+#ifndef BUSY_BEAVER_HPP
+#define BUSY_BEAVER_HPP
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "Engine.hpp"
+#include "Program.hpp"
+
+/** Returns the blank program with the given number of states and symbols
+ * used for busy beaver machines: states are labelled A, B, ..., with an
+ * extra final state Z to halt on, and the symbols are the blank followed by
+ * the digits 1, 2, ...
+ */
+Program busyBeaverProgram(unsigned states, unsigned symbols);
+
+/** Parses the standard compact notation of a busy beaver program into
+ * program. Any state letter beyond the last row (e.g. Z) halts
+ * @return True on failure, false on success
+ */
+bool fromCompact(const std::string& str, Program& program);
+
+/** Returns the standard compact notation of a busy beaver program, e.g.
+ * 1RB1LB_1LA1RZ, with "---" for missing transitions
+ */
+std::string toCompact(const Program& program);
+
+/** @struct BusyBeaverConfig
+ * The parameters of an enumeration
+ */
+struct BusyBeaverConfig {
+    unsigned states, symbols;
+
+    /** The number of steps after which a machine is handed to the deciders */
+    std::uint64_t steps;
+
+    /** The number of tape cells after which a machine is handed to the
+     * deciders
+     */
+    std::size_t space;
+
+    /** The depth limit for backward reasoning */
+    unsigned depth;
+
+    /** The number of threads to use, or zero for all cores */
+    unsigned threads;
+
+    BusyBeaverConfig();
+};
+
+/** @struct BusyBeaverStats
+ * The classification counts and champions of (part of) an enumeration
+ */
+struct BusyBeaverStats {
+    std::uint64_t enumerated, halted, cyclers, translated, backward;
+
+    /** The number of database records that could not be decoded */
+    std::uint64_t malformed;
+
+    /** Undecided machines, in compact notation */
+    std::vector<std::string> holdouts;
+
+    /** The halting machines with the most steps and the most non-blank
+     * cells, in compact notation
+     */
+    std::string stepsChampion, onesChampion;
+    std::uint64_t maxSteps, maxOnes;
+
+    BusyBeaverStats();
+
+    /** Adds the counts of other to this and keeps the better champions */
+    void merge(const BusyBeaverStats& other);
+
+    /** Prints the counts and champions */
+    void print(std::ostream& os) const;
+};
+
+/** @class BusyBeaver
+ * Enumerates all machines of a given size in tree normal form: starting
+ * from the machine whose only transition is A0 -> 1RB, each machine is run
+ * on a blank tape until it reaches a missing transition, which is then
+ * filled in every possible way. Only the first unused state and symbol are
+ * considered as targets, so isomorphic machines are generated once.
+ * Machines that never reach a missing transition are classified by the
+ * deciders or reported as holdouts
+ */
+class BusyBeaver {
+    BusyBeaverConfig config_;
+
+    /** @struct Node
+     * A machine in the enumeration tree
+     */
+    struct Node {
+        Program program;
+
+        /** The number of states and symbols used by defined transitions */
+        unsigned states, symbols;
+
+        /** The number of defined transitions */
+        unsigned defined;
+
+        /** The configuration the run of the machine continues from, where
+         * its parent reached the transition the machine adds
+         */
+        FlatTape tape;
+        std::uint32_t state;
+        std::uint64_t steps;
+    };
+
+    /** Classifies the machine of node and enumerates its children. exec
+     * must be positioned at the configuration of node, and each child
+     * continues from where node reached its missing transition rather
+     * than from a blank tape, since everything before is the same. If
+     * children is non-null, the children are appended to it instead of
+     * being searched
+     */
+    void search(Node& node, Execution& exec, BusyBeaverStats& stats,
+                std::vector<Node>* children);
+
+    /** Runs the deciders on a machine that did not reach a missing
+     * transition within the limits
+     * @return True if the machine was decided, false if it is a holdout
+     */
+    bool decide(const Program& program, BusyBeaverStats& stats);
+
+    /** Counts a machine that halted after the given number of steps with
+     * the given number of non-blank cells
+     */
+    void halted(const Program& program, std::uint64_t steps,
+                std::uint64_t ones, BusyBeaverStats& stats);
+
+public:
+    BusyBeaver(const BusyBeaverConfig& config);
+
+    /** Runs a complete machine on a blank tape and classifies it as halting
+     * (a missing transition or the halting state is reached), decided or
+     * undecided
+     * @return True if the machine is a holdout, false otherwise
+     */
+    bool classify(const Program& program, Execution& exec,
+                  BusyBeaverStats& stats);
+
+    /** Enumerates every machine in parallel */
+    BusyBeaverStats run();
+};
+
+#endif /* BUSY_BEAVER_HPP */
@@ -0,0 +1,18 @@
+#ifndef CPU_FEATURES_HPP
+#define CPU_FEATURES_HPP
+
+/** Returns whether the processor supports AVX2. The processor is queried
+ * on the first call rather than while static objects are initialized, so
+ * code running before main() can call it
+ */
+inline bool hasAvx2()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    static const bool avx2 = __builtin_cpu_supports("avx2");
+    return avx2;
+#else
+    return false;
+#endif
+}
+
+#endif /* CPU_FEATURES_HPP */
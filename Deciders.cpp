@@ -0,0 +1,270 @@
+#include <deque>
+#include <utility>
+#include <vector>
+#include "Deciders.hpp"
+#include "Engine.hpp"
+
+/** The number of cells next to a record that the translated cycler keeps */
+constexpr long RECORD_WINDOW = 256;
+
+/** The number of records per side that the translated cycler compares */
+constexpr std::size_t MAX_RECORDS = 32;
+
+/** The number of partial configurations backward reasoning may visit */
+constexpr std::size_t MAX_NODES = 100000;
+
+/** Executes one step of program on tape
+ * @return Zero on success, positive if no transition applied, and negative
+ * if the tape is full
+ */
+static int step(const Program& program, FlatTape& tape, std::uint32_t& state)
+{
+    const Transition& t = program.at(state, program.column(tape.head()));
+    if (t.next == NO_STATE)
+        return 1;
+    tape.head() = t.write;
+    state = t.next;
+    return tape.move(t.shift) ? -1 : 0;
+}
+
+/** @struct Snapshot
+ * The non-blank part of a tape
+ */
+struct Snapshot {
+    long left;
+    std::vector<std::uint8_t> cells;
+
+    void take(const FlatTape& tape)
+    {
+        long l = tape.left(), r = tape.right();
+        while (l <= r && !tape.at(l))
+            ++l;
+        while (r >= l && !tape.at(r))
+            --r;
+        left = l;
+        cells.clear();
+        for (long pos = l; pos <= r; ++pos)
+            cells.push_back(tape.at(pos));
+    }
+
+    bool matches(const FlatTape& tape) const
+    {
+        long l = tape.left(), r = tape.right();
+        long end = left + (long)cells.size();
+        for (long pos = std::min(l, left); pos <= std::max(r, end); ++pos) {
+            std::uint8_t cell = (pos >= left && pos < end) ?
+                cells[pos - left] : 0;
+            if (cell != tape.at(pos))
+                return false;
+        }
+        return true;
+    }
+};
+
+bool decideCycler(const Program& program, std::uint64_t steps,
+                  std::size_t space)
+{
+    FlatTape tape(space);
+    tape.write("");
+    std::uint32_t state = 0;
+
+    // Brent's algorithm: compare against a snapshot taken at each power of
+    // two, which finds any cycle within twice its period plus its preperiod
+    std::uint32_t snapState = state;
+    long snapPos = 0;
+    Snapshot snap;
+    snap.take(tape);
+    for (std::uint64_t i = 1, power = 1; i <= steps; ++i) {
+        if (step(program, tape, state))
+            return false;
+        if (state == snapState && tape.position() == snapPos &&
+            snap.matches(tape))
+            return true;
+        if (i == power) {
+            snapState = state;
+            snapPos = tape.position();
+            snap.take(tape);
+            power *= 2;
+        }
+    }
+    return false;
+}
+
+/** @struct Record
+ * A visit to a cell beyond all previously visited cells on one side
+ */
+struct Record {
+    std::uint32_t state;
+    long pos;
+
+    /** The furthest the head went back towards the other side since this
+     * record, as of the latest record on the same side
+     */
+    long extreme;
+
+    /** The RECORD_WINDOW + 1 cells ending (for right records) or starting
+     * (for left records) at pos
+     */
+    std::vector<std::uint8_t> cells;
+};
+
+/** Checks a new record on one side against earlier ones. dir is +1 for the
+ * right side and -1 for the left side
+ * @return True if the machine is a translated cycler
+ */
+static bool checkRecords(std::deque<Record>& records, const FlatTape& tape,
+                         std::uint32_t state, long since, int dir)
+{
+    long pos = tape.position();
+    for (Record& r : records) {
+        r.extreme = dir > 0 ? std::min(r.extreme, since)
+                            : std::max(r.extreme, since);
+        if (r.state != state)
+            continue;
+        long back = (r.pos - r.extreme) * dir;
+        if (back > RECORD_WINDOW)
+            continue;
+        bool same = true;
+        for (long k = 0; k <= back && same; ++k)
+            same = r.cells[RECORD_WINDOW - k] == tape.at(pos - k * dir);
+        if (same)
+            return true;
+    }
+    Record record;
+    record.state = state;
+    record.pos = record.extreme = pos;
+    for (long k = RECORD_WINDOW; k >= 0; --k)
+        record.cells.push_back(tape.at(pos - k * dir));
+    records.push_back(std::move(record));
+    if (records.size() > MAX_RECORDS)
+        records.pop_front();
+    return false;
+}
+
+bool decideTranslatedCycler(const Program& program, std::uint64_t steps,
+                            std::size_t space)
+{
+    FlatTape tape(space);
+    tape.write("");
+    std::uint32_t state = 0;
+    std::deque<Record> left, right;
+    long leftmost = 0, rightmost = 0;
+    long minSince = 0, maxSince = 0;
+    for (std::uint64_t i = 0; i < steps; ++i) {
+        if (step(program, tape, state))
+            return false;
+        long pos = tape.position();
+        minSince = std::min(minSince, pos);
+        maxSince = std::max(maxSince, pos);
+        if (pos > rightmost) {
+            rightmost = pos;
+            if (checkRecords(right, tape, state, minSince, 1))
+                return true;
+            minSince = pos;
+        } else if (pos < leftmost) {
+            leftmost = pos;
+            if (checkRecords(left, tape, state, maxSince, -1))
+                return true;
+            maxSince = pos;
+        }
+    }
+    return false;
+}
+
+/** @struct Partial
+ * A configuration in which only some cells are known
+ */
+struct Partial {
+    std::uint32_t state;
+    long head;
+    std::vector<std::pair<long, std::uint8_t>> cells;
+
+    /** Returns the known column at pos, or -1 if it is unknown */
+    int get(long pos) const
+    {
+        for (const auto& cell : cells) {
+            if (cell.first == pos)
+                return cell.second;
+        }
+        return -1;
+    }
+
+    void set(long pos, std::uint8_t column)
+    {
+        for (auto& cell : cells) {
+            if (cell.first == pos) {
+                cell.second = column;
+                return;
+            }
+        }
+        cells.emplace_back(pos, column);
+    }
+};
+
+/** @struct Predecessor
+ * A transition that enters a given state
+ */
+struct Predecessor {
+    std::uint32_t state;
+    std::uint8_t read, write;
+    std::int8_t shift;
+};
+
+/** Returns whether config might be reachable from the start, i.e., whether
+ * the search could not rule it out within the given depth
+ */
+static bool mayReach(const std::vector<std::vector<Predecessor>>& preds,
+                     const Partial& config, unsigned depth,
+                     std::size_t& nodes)
+{
+    if (++nodes > MAX_NODES || !depth)
+        return true;
+    if (config.state == 0) {
+        bool blank = true;
+        for (const auto& cell : config.cells)
+            blank &= !cell.second;
+        if (blank)
+            return true;
+    }
+    for (const Predecessor& pred : preds[config.state]) {
+        long head = config.head - pred.shift;
+        int known = config.get(head);
+        if (known >= 0 && known != pred.write)
+            continue;
+        Partial prev = config;
+        prev.state = pred.state;
+        prev.head = head;
+        prev.set(head, pred.read);
+        if (mayReach(preds, prev, depth - 1, nodes))
+            return true;
+    }
+    return false;
+}
+
+bool decideBackward(const Program& program, unsigned depth)
+{
+    // Every column but the last, which only holds symbols the program never
+    // writes and so can not appear on a tape that started blank
+    std::uint32_t columns = program.columns() - 1;
+    std::vector<std::vector<Predecessor>> preds(program.states());
+    for (std::uint32_t s = 0; s < program.states(); ++s) {
+        for (std::uint32_t c = 0; c < columns; ++c) {
+            const Transition& t = program.at(s, c);
+            if (t.next != NO_STATE) {
+                preds[t.next].push_back({s, (std::uint8_t)c,
+                                         program.column(t.write), t.shift});
+            }
+        }
+    }
+    std::size_t nodes = 0;
+    for (std::uint32_t s = 0; s < program.states(); ++s) {
+        for (std::uint32_t c = 0; c < columns; ++c) {
+            if (program.at(s, c).next != NO_STATE)
+                continue;
+            Partial config{s, 0, {{0, (std::uint8_t)c}}};
+            if (mayReach(preds, config, depth, nodes))
+                return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,32 @@
+#ifndef DECIDERS_HPP
+#define DECIDERS_HPP
+
+#include <cstdint>
+#include "Program.hpp"
+
+/** Deciders prove that a program started in state zero on a blank tape
+ * never stops. Each one returns true only when it has such a proof, so
+ * false means "undecided" rather than "halts". Missing transitions are
+ * treated as halting
+ */
+
+/** Detects machines that return to an exact earlier configuration (state,
+ * head position and tape) within the given number of steps and cells
+ */
+bool decideCycler(const Program& program, std::uint64_t steps,
+                  std::size_t space);
+
+/** Detects machines that repeat the same behavior shifted along the tape:
+ * two record-breaking visits to a new cell in the same state, where the
+ * part of the tape that was read in between is identical at both records
+ */
+bool decideTranslatedCycler(const Program& program, std::uint64_t steps,
+                            std::size_t space);
+
+/** Searches backwards from every missing transition for a configuration
+ * that could lead to it, proving that none can be reached from the start if
+ * every branch ends in a contradiction within the given depth
+ */
+bool decideBackward(const Program& program, unsigned depth);
+
+#endif /* DECIDERS_HPP */
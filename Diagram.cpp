@@ -0,0 +1,111 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include "Diagram.hpp"
+#include "StateParser.hpp"
+
+/** The shade of the blank */
+constexpr std::uint8_t WHITE = 255;
+
+/** The shade of the lightest symbol other than the blank, so that every
+ * symbol stands out against the blank
+ */
+constexpr unsigned LIGHTEST = 192;
+
+SpaceTimeDiagram::SpaceTimeDiagram(const Program& program,
+                                   std::uint32_t width, std::uint32_t height,
+                                   std::uint64_t interval,
+                                   std::uint64_t cellsPerColumn) :
+    width_(std::max<std::uint32_t>(width + (width & 1), 2)),
+    height_(std::max<std::uint32_t>(height + (height & 1), 2)),
+    interval_(std::max<std::uint64_t>(interval, 1)),
+    cellsPerColumn_(std::max<std::uint64_t>(cellsPerColumn, 1)), rows_(0),
+    pixels_((std::size_t)width_ * height_, WHITE)
+{
+    // Leave a quarter of the columns to the left of the head, since inputs
+    // extend to the right
+    first_ = -(long)(width_ / 4 * cellsPerColumn_);
+
+    // Symbols get darker by column, from LIGHTEST for the last column (the
+    // symbols the program does not know) to black for the first symbol
+    // after the blank
+    std::uint32_t symbols = program.columns() - 1;
+    for (unsigned cell = 0; cell < 256; ++cell) {
+        std::uint32_t c = program.column(cell);
+        shade_[cell] = c ? (c - 1) * LIGHTEST / std::max(symbols - 1, 1u)
+                         : WHITE;
+    }
+}
+
+void SpaceTimeDiagram::mergeRows()
+{
+    for (std::uint32_t r = 0; r < rows_ / 2; ++r) {
+        const std::uint8_t* a = &pixels_[(std::size_t)2 * r * width_];
+        const std::uint8_t* b = a + width_;
+        std::uint8_t* row = &pixels_[(std::size_t)r * width_];
+        for (std::uint32_t j = 0; j < width_; ++j)
+            row[j] = (a[j] + b[j] + 1) / 2;
+    }
+    rows_ /= 2;
+    interval_ *= 2;
+}
+
+void SpaceTimeDiagram::widen(bool right)
+{
+    std::uint32_t half = width_ / 2, offset = right ? 0 : half;
+    std::vector<std::uint8_t> row(width_);
+    for (std::uint32_t r = 0; r < rows_; ++r) {
+        std::uint8_t* old = &pixels_[(std::size_t)r * width_];
+        std::fill(row.begin(), row.end(), WHITE);
+        for (std::uint32_t j = 0; j < half; ++j)
+            row[offset + j] = (old[2 * j] + old[2 * j + 1] + 1) / 2;
+        std::copy(row.begin(), row.end(), old);
+    }
+    if (!right)
+        first_ -= (long)(width_ * cellsPerColumn_);
+    cellsPerColumn_ *= 2;
+}
+
+void SpaceTimeDiagram::cover(long pos)
+{
+    while (pos < first_)
+        widen(false);
+    while (pos >= first_ + (long)(width_ * cellsPerColumn_))
+        widen(true);
+}
+
+void SpaceTimeDiagram::sample(const FlatTape& tape)
+{
+    cover(tape.position());
+    if (rows_ == height_)
+        mergeRows();
+    std::uint8_t* row = &pixels_[(std::size_t)rows_++ * width_];
+    const std::uint8_t* cells = tape.cells();
+    long left = tape.left(), right = tape.right() + 1;
+    long begin = first_, n = cellsPerColumn_;
+    for (std::uint32_t j = 0; j < width_; ++j, begin += n) {
+        // Only the cells the tape stores can be other than blank
+        long from = std::max(begin, left), to = std::min(begin + n, right);
+        std::uint64_t sum = (std::uint64_t)WHITE * n;
+        for (long pos = from; pos < to; ++pos)
+            sum -= WHITE - shade_[cells[pos]];
+        row[j] = sum / n;
+    }
+}
+
+bool SpaceTimeDiagram::write(const char* path) const
+{
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        err << path << ": " << std::strerror(errno) << std::endl;
+        return true;
+    }
+    file << "P5\n" << width_ << ' ' << rows_ << "\n255\n";
+    file.write((const char*)pixels_.data(), (std::size_t)width_ * rows_);
+    if (!file.flush()) {
+        err << path << ": Write error" << std::endl;
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,77 @@
+#ifndef DIAGRAM_HPP
+#define DIAGRAM_HPP
+
+#include <cstdint>
+#include <vector>
+#include "Engine.hpp"
+
+/** @class SpaceTimeDiagram
+ * A grayscale image of a run with one row per sample of the tape, the
+ * first sample on top, and one column per group of cells. Each pixel is
+ * the average shade of the cells it covers: white for the blank, and darker
+ * for each symbol of the program's alphabet. The image never exceeds its
+ * width and height, however long the run: when the rows are full, adjacent
+ * rows are averaged and the number of steps per row doubles, and when the
+ * head leaves the columns, adjacent columns are averaged toward the other
+ * side and the number of cells per column doubles
+ */
+class SpaceTimeDiagram {
+    /** The number of columns, which is even */
+    std::uint32_t width_;
+
+    /** The largest number of rows, which is even */
+    std::uint32_t height_;
+
+    /** The number of steps between samples */
+    std::uint64_t interval_;
+
+    /** The number of cells per column */
+    std::uint64_t cellsPerColumn_;
+
+    /** The position of the first cell of the first column */
+    long first_;
+
+    /** The number of rows sampled */
+    std::uint32_t rows_;
+
+    /** The rows, width_ pixels each */
+    std::vector<std::uint8_t> pixels_;
+
+    /** The shade of each encoded cell */
+    std::uint8_t shade_[256];
+
+    /** Averages each pair of rows into one, doubling the interval */
+    void mergeRows();
+
+    /** Averages each pair of columns into one, doubling the cells per
+     * column, and moves the old columns to the left half of the image if
+     * right is set or to the right half otherwise
+     */
+    void widen(bool right);
+
+public:
+    /** @param width The number of columns
+     * @param height The largest number of rows
+     * @param interval The number of steps between samples to start with
+     * @param cellsPerColumn The number of cells per column to start with
+     */
+    SpaceTimeDiagram(const Program& program, std::uint32_t width = 1024,
+                     std::uint32_t height = 1024, std::uint64_t interval = 1,
+                     std::uint64_t cellsPerColumn = 1);
+
+    /** Returns the number of steps to run before the next sample */
+    std::uint64_t interval() const { return interval_; }
+
+    /** Widens the columns until they include the given position */
+    void cover(long pos);
+
+    /** Adds a row showing the tape, covering the head first */
+    void sample(const FlatTape& tape);
+
+    /** Writes the image as a binary PGM file
+     * @return True on failure (with diagnostics in err), false on success
+     */
+    bool write(const char* path) const;
+};
+
+#endif /* DIAGRAM_HPP */
@@ -0,0 +1,109 @@
+#include <algorithm>
+#include <cstring>
+#include "Engine.hpp"
+
+FlatTape::FlatTape(std::size_t maxCells) :
+    cells_(64), origin_(32), head_(32), maxCells_(maxCells) {}
+
+bool FlatTape::grow()
+{
+    std::size_t size = cells_.size();
+    if (size >= maxCells_)
+        return true;
+    std::size_t grown = std::min(size * 2, maxCells_);
+    std::size_t offset = (grown - size) / 2;
+    if (!offset)
+        return true;
+    cells_.insert(cells_.begin(), offset, 0);
+    cells_.resize(grown, 0);
+    origin_ += offset;
+    head_ += offset;
+    return false;
+}
+
+void FlatTape::write(const char* str)
+{
+    std::size_t n = std::strlen(str);
+    std::size_t size = std::max<std::size_t>(64, 2 * (n + 2));
+    if (cells_.size() < size)
+        cells_.assign(size, 0);
+    else
+        std::fill(cells_.begin(), cells_.end(), 0);
+    origin_ = head_ = (cells_.size() - n) / 2;
+    for (std::size_t i = 0; i < n; ++i)
+        cells_[origin_ + i] = Program::encode(str[i]);
+}
+
+std::size_t FlatTape::sweep(int shift, const SweepSet& set, std::size_t max)
+{
+    std::size_t n;
+    if (shift > 0) {
+        n = std::min(max, cells_.size() - 2 - head_);
+        n = spanForward(&cells_[head_], n, set);
+        head_ += n;
+    } else {
+        n = std::min(max, head_ - 1);
+        n = spanBackward(&cells_[head_], n, set);
+        head_ -= n;
+    }
+    return n;
+}
+
+std::string FlatTape::contents() const
+{
+    std::size_t begin = 0, end = cells_.size();
+    while (begin < end && !cells_[begin])
+        ++begin;
+    while (end > begin && !cells_[end - 1])
+        --end;
+    std::string str(end - begin, BLANK);
+    for (std::size_t i = begin; i < end; ++i)
+        str[i - begin] = Program::decode(cells_[i]);
+    return str;
+}
+
+bool FlatTape::outOfMemory() const
+{
+    return cells_.size() >= maxCells_;
+}
+
+const char* describe(Outcome outcome)
+{
+    switch (outcome) {
+    case Outcome::Accepted:
+        return "accepted";
+    case Outcome::Jammed:
+        return "jammed";
+    case Outcome::StepLimit:
+        return "step-limit";
+    case Outcome::OutOfMemory:
+        return "out-of-memory";
+    case Outcome::Crashed:
+        return "crashed";
+    }
+    return "unknown";
+}
+
+Execution::Execution(const Program& program, std::size_t maxCells) :
+    program_(program), tape_(maxCells), state_(0), steps_(0) {}
+
+void Execution::reset(const char* input)
+{
+    tape_.write(input);
+    state_ = 0;
+    steps_ = 0;
+}
+
+void Execution::resume(const FlatTape& tape, std::uint32_t state,
+                       std::uint64_t steps)
+{
+    tape_ = tape;
+    state_ = state;
+    steps_ = steps;
+}
+
+Outcome Execution::run(std::uint64_t steps)
+{
+    NoTrace observer;
+    return run(steps, observer);
+}
@@ -0,0 +1,298 @@
+#ifndef ENGINE_HPP
+#define ENGINE_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Program.hpp"
+
+/** The flat tape stores one byte per cell, so it can afford many more cells
+ * than the linked tape before running out of memory
+ */
+#ifdef MAX_FLAT_TAPE_CELLS
+constexpr std::size_t MAX_FLAT_CELLS = MAX_FLAT_TAPE_CELLS;
+#else
+constexpr std::size_t MAX_FLAT_CELLS = 1 << 26;
+#endif /* MAX_FLAT_TAPE_CELLS */
+
+/** @class FlatTape
+ * A tape stored as a contiguous array of encoded cells (@see
+ * Program::encode()) that grows in both directions when the head reaches
+ * either end. Positions are relative to the cell the head started on
+ */
+class FlatTape {
+    /** The cells, which are blank (zero) when not written */
+    std::vector<std::uint8_t> cells_;
+
+    /** The index of position zero */
+    std::size_t origin_;
+
+    /** The index of the head */
+    std::size_t head_;
+
+    /** The maximum number of cells */
+    std::size_t maxCells_;
+
+    /** Doubles the storage, keeping the used cells centered
+     * @return True if the tape would exceed its maximum size, false
+     * otherwise
+     */
+    bool grow();
+
+public:
+    explicit FlatTape(std::size_t maxCells = MAX_FLAT_CELLS);
+
+    /** Clears the tape and writes the given string to it, positioning the
+     * head at the front of the string
+     */
+    void write(const char* str);
+
+    /** Returns the encoded cell under the head */
+    std::uint8_t& head() { return cells_[head_]; }
+    std::uint8_t head() const { return cells_[head_]; }
+
+    /** Moves the head by the given number of cells (-1, 0 or 1)
+     * @return True if there is an error (i.e., out of memory), false
+     * otherwise
+     */
+    bool move(int shift)
+    {
+        head_ += shift;
+        return (head_ == 0 || head_ + 1 == cells_.size()) && grow();
+    }
+
+    /** Moves the head in the direction of shift over every cell in the set,
+     * stopping at the first cell not in it, after at most max cells, or
+     * before the tape would need to grow
+     * @return The number of cells moved over
+     */
+    std::size_t sweep(int shift, const SweepSet& set, std::size_t max);
+
+    /** Returns the position of the head */
+    long position() const { return (long)head_ - (long)origin_; }
+
+    /** Returns the lowest and highest positions that are stored; all cells
+     * outside of this range are blank
+     */
+    long left() const { return -(long)origin_; }
+    long right() const { return (long)(cells_.size() - origin_) - 1; }
+
+    /** Returns the encoded cell at the given position */
+    std::uint8_t at(long pos) const
+    {
+        return (pos < left() || pos > right()) ? 0 : cells_[origin_ + pos];
+    }
+
+    /** Returns the encoded cells indexed by position, which is valid from
+     * left() to right()
+     */
+    const std::uint8_t* cells() const { return cells_.data() + origin_; }
+
+    /** Returns the symbols between the leftmost and rightmost non-blank
+     * cells
+     */
+    std::string contents() const;
+
+    /** Returns whether the tape has reached its maximum size */
+    bool outOfMemory() const;
+};
+
+/** How a run of an Execution ended */
+enum class Outcome {
+    /** No rule applied and the machine is on a final state */
+    Accepted,
+    /** No rule applied and the machine is not on a final state */
+    Jammed,
+    /** The step budget was exhausted before the machine stopped */
+    StepLimit,
+    /** The tape ran out of memory */
+    OutOfMemory,
+    /** The process running the machine died, e.g. a worker of a
+     * ProcessPool that was killed for exceeding its memory limit
+     */
+    Crashed,
+};
+
+/** Returns a short name for the outcome, without spaces */
+const char* describe(Outcome outcome);
+
+/** @struct NoTrace
+ * An Engine observer that observes nothing, so that it compiles away
+ */
+struct NoTrace {
+    /** Whether the engine may sweep (@see SWEEP), executing whole runs of
+     * transitions without showing them to the observer
+     */
+    static constexpr bool SWEEPS = true;
+
+    /** Called before the transition for the given state and column is
+     * executed
+     */
+    void transition(std::uint32_t, std::uint32_t) {}
+};
+
+/** @struct NoSweeps
+ * An Engine observer like NoTrace that keeps the engine from sweeping, for
+ * runs whose loops are too short for sweeps to pay off
+ */
+struct NoSweeps {
+    static constexpr bool SWEEPS = false;
+
+    void transition(std::uint32_t, std::uint32_t) {}
+};
+
+/** @struct TransitionCounter
+ * An Engine observer that counts how often each transition is executed
+ */
+struct TransitionCounter {
+    static constexpr bool SWEEPS = false;
+
+    /** The counts, indexed like the transition table (state * columns +
+     * column)
+     */
+    std::vector<std::uint64_t> counts;
+
+    std::uint32_t columns;
+
+    explicit TransitionCounter(const Program& program) :
+        counts(program.states() * program.columns(), 0),
+        columns(program.columns()) {}
+
+    void transition(std::uint32_t state, std::uint32_t column)
+    {
+        ++counts[state * columns + column];
+    }
+};
+
+/** @struct StepBudget
+ * An Engine limit that stops after a number of steps
+ */
+struct StepBudget {
+    std::uint64_t steps;
+
+    /** Returns whether another step may be executed after n steps */
+    bool more(std::uint64_t n) const { return n < steps; }
+
+    /** Returns the number of steps left after n steps */
+    std::uint64_t remaining(std::uint64_t n) const { return steps - n; }
+};
+
+/** @struct Unbounded
+ * An Engine limit that runs until the machine stops or the tape runs out of
+ * memory
+ */
+struct Unbounded {
+    bool more(std::uint64_t) const { return true; }
+    std::uint64_t remaining(std::uint64_t) const { return UINT64_MAX; }
+};
+
+/** @class Engine
+ * The run loop of compiled programs, specialized at compile time for a
+ * tape, an observer (e.g. NoTrace) and a limit (e.g. StepBudget), so that
+ * a run pays only for the features it uses. The tape must provide head(),
+ * move() and sweep() like FlatTape
+ */
+template <class TapeType, class Observer, class Limit>
+struct Engine {
+    /** Executes program on tape from the given state until no transition
+     * applies, the tape runs out of memory or the limit is reached
+     * @param state Updated to the state the run stopped on
+     * @param steps Increased by the number of steps executed
+     */
+    static Outcome run(const Program& program, TapeType& tape,
+                       std::uint32_t& state, std::uint64_t& steps,
+                       Observer& observer, const Limit& limit)
+    {
+        const Transition* table = program.table();
+        const std::uint8_t* column = program.columnMap();
+        std::uint32_t columns = program.columns();
+        std::uint32_t s = state;
+        std::uint64_t n = 0;
+        Outcome outcome = Outcome::StepLimit;
+        while (limit.more(n)) {
+            std::uint8_t& cell = tape.head();
+            std::uint32_t c = column[cell];
+            const Transition& t = table[s * columns + c];
+            if (t.next == NO_STATE) {
+                outcome = program.final(s) ? Outcome::Accepted
+                                           : Outcome::Jammed;
+                break;
+            }
+            observer.transition(s, c);
+            cell = (cell & t.keep) | t.write;
+            s = t.next;
+            ++n;
+            if (tape.move(t.shift)) {
+                outcome = Outcome::OutOfMemory;
+                break;
+            }
+            if (Observer::SWEEPS && (t.flags & SWEEP)) {
+                n += tape.sweep(t.shift, program.sweep(s),
+                                limit.remaining(n));
+            }
+        }
+        state = s;
+        steps += n;
+        return outcome;
+    }
+};
+
+/** @class Execution
+ * A resumable run of a compiled program on a flat tape. This is the fast
+ * counterpart to TuringMachine: there is no per-step symbol search, only
+ * one table lookup, and sweeps (@see SWEEP) move the head over whole runs
+ * of cells at once
+ */
+class Execution {
+    /** The program being executed */
+    const Program& program_;
+
+    FlatTape tape_;
+
+    /** The id of the current state */
+    std::uint32_t state_;
+
+    /** The number of steps executed since the last reset */
+    std::uint64_t steps_;
+
+public:
+    Execution(const Program& program, std::size_t maxCells = MAX_FLAT_CELLS);
+
+    /** Writes the input to the tape and returns to the initial state */
+    void reset(const char* input);
+
+    /** Executes at most the given number of steps, or until the machine
+     * stops if steps is UINT64_MAX. The run may be resumed by calling this
+     * again
+     */
+    Outcome run(std::uint64_t steps);
+
+    /** Executes like run(), showing each transition to observer (@see
+     * Engine)
+     */
+    template <class Observer>
+    Outcome run(std::uint64_t steps, Observer& observer)
+    {
+        if (steps == UINT64_MAX) {
+            return Engine<FlatTape, Observer, Unbounded>::run(
+                program_, tape_, state_, steps_, observer, Unbounded());
+        }
+        return Engine<FlatTape, Observer, StepBudget>::run(
+            program_, tape_, state_, steps_, observer, StepBudget{steps});
+    }
+
+    /** Continues a run that was started elsewhere (@see runTiered()) on
+     * the given tape, in the given state and after the given number of
+     * steps
+     */
+    void resume(const FlatTape& tape, std::uint32_t state,
+                std::uint64_t steps);
+
+    const Program& program() const { return program_; }
+    FlatTape& tape() { return tape_; }
+    const FlatTape& tape() const { return tape_; }
+    std::uint32_t state() const { return state_; }
+    std::uint64_t steps() const { return steps_; }
+};
+
+#endif /* ENGINE_HPP */
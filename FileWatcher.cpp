@@ -0,0 +1,55 @@
+#include <algorithm>
+#include <sys/inotify.h>
+#include <unistd.h>
+#include "FileWatcher.hpp"
+
+FileWatcher::FileWatcher() : fd_(inotify_init1(IN_NONBLOCK | IN_CLOEXEC)) {}
+
+FileWatcher::~FileWatcher()
+{
+    if (fd_ >= 0)
+        close(fd_);
+}
+
+bool FileWatcher::watch(const std::string& path)
+{
+    if (fd_ < 0)
+        return true;
+    std::size_t slash = path.rfind('/');
+    std::string dir = slash == std::string::npos ? "." : path.substr(0, slash);
+    std::string name = slash == std::string::npos ? path
+                                                  : path.substr(slash + 1);
+    if (dir.empty())
+        dir = "/";
+    int wd = inotify_add_watch(fd_, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+    if (wd < 0)
+        return true;
+    files_[wd][name] = path;
+    return false;
+}
+
+std::vector<std::string> FileWatcher::changed()
+{
+    std::vector<std::string> paths;
+    if (fd_ < 0)
+        return paths;
+    alignas(inotify_event) char buffer[4096];
+    ssize_t n;
+    while ((n = read(fd_, buffer, sizeof(buffer))) > 0) {
+        for (char* p = buffer; p < buffer + n;) {
+            const inotify_event* event = (const inotify_event*)p;
+            p += sizeof(inotify_event) + event->len;
+            auto dir = files_.find(event->wd);
+            if (dir == files_.end() || !event->len)
+                continue;
+            auto file = dir->second.find(event->name);
+            if (file != dir->second.end() &&
+                std::find(paths.begin(), paths.end(), file->second) ==
+                paths.end())
+            {
+                paths.push_back(file->second);
+            }
+        }
+    }
+    return paths;
+}
@@ -0,0 +1,41 @@
+#ifndef FILE_WATCHER_HPP
+#define FILE_WATCHER_HPP
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/** @class FileWatcher
+ * Reports changes to a set of files through inotify. The directories of the
+ * files are watched rather than the files themselves, so that editors which
+ * save by writing a new file and renaming it over the old one are noticed
+ */
+class FileWatcher {
+    /** The inotify instance, or -1 if it could not be created */
+    int fd_;
+
+    /** The watched files of each watched directory by name, mapped to the
+     * paths they were added with
+     */
+    std::unordered_map<int, std::unordered_map<std::string, std::string>>
+        files_;
+
+public:
+    FileWatcher();
+    ~FileWatcher();
+
+    FileWatcher(const FileWatcher&) = delete;
+    FileWatcher& operator=(const FileWatcher&) = delete;
+
+    /** Starts watching the file at path
+     * @return True on failure, false on success
+     */
+    bool watch(const std::string& path);
+
+    /** Returns the paths of the files that were written since the last call,
+     * each once, without blocking
+     */
+    std::vector<std::string> changed();
+};
+
+#endif /* FILE_WATCHER_HPP */
@@ -0,0 +1,41 @@
+#ifndef HASH_HPP
+#define HASH_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/** The 64-bit FNV-1a offset basis, used as the initial hash */
+constexpr std::uint64_t HASH_SEED = 0xcbf29ce484222325;
+
+/** Returns the 64-bit FNV-1a hash of the given bytes, continuing from the
+ * given hash so that several pieces can be hashed as one
+ */
+inline std::uint64_t hashBytes(const void* data, std::size_t size,
+                               std::uint64_t hash = HASH_SEED)
+{
+    const unsigned char* bytes = (const unsigned char*)data;
+    for (std::size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3;
+    }
+    return hash;
+}
+
+inline std::uint64_t hashBytes(const std::string& str,
+                               std::uint64_t hash = HASH_SEED)
+{
+    return hashBytes(str.data(), str.size(), hash);
+}
+
+/** Returns the hash as 16 lowercase hexadecimal digits */
+inline std::string hashString(std::uint64_t hash)
+{
+    static const char digits[] = "0123456789abcdef";
+    std::string str(16, '0');
+    for (int i = 15; i >= 0; --i, hash >>= 4)
+        str[i] = digits[hash & 0xF];
+    return str;
+}
+
+#endif /* HASH_HPP */
@@ -0,0 +1,310 @@
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <poll.h>
+#include <sstream>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+#include "Hash.hpp"
+#include "JobServer.hpp"
+#include "Socket.hpp"
+#include "StateOptimizer.hpp"
+#include "StateParser.hpp"
+
+/** The largest source or input a request may carry, several times the
+ * source of a machine with 60,000 states
+ */
+constexpr std::size_t MAX_PAYLOAD = 16 << 20;
+
+/** The number of bytes of sources the program cache keeps */
+constexpr std::size_t PROGRAM_CACHE_BYTES = 64 << 20;
+
+/** How often the accept loop checks for a stop signal, and a connection
+ * waiting for a run checks for a hang-up, in milliseconds
+ */
+constexpr int POLL_INTERVAL = 500;
+
+/** The most connections served at once. Connection threads mostly wait
+ * for runs, which share the scheduler's threads, and are only started
+ * when connections are waiting for one
+ */
+constexpr unsigned MAX_CONNECTIONS = 64;
+
+/** Set by the signal handler to stop the server */
+static volatile std::sig_atomic_t interrupted = 0;
+
+static void interrupt(int)
+{
+    interrupted = 1;
+}
+
+/** Serializes compilations, since the parser reports errors through the
+ * global err stream
+ */
+static std::mutex compileMutex;
+
+ProgramCache::ProgramCache(std::size_t capacity, bool optimize) :
+    size_(0), capacity_(capacity), optimize_(optimize) {}
+
+std::shared_ptr<const Program> ProgramCache::reuse(
+    std::list<Entry>::iterator entry, const std::string& source,
+    std::uint64_t& digest, std::string& error)
+{
+    // The id is handed out for RUN requests, so it may name only one source
+    if (entry->source != source) {
+        error = "Program id " + hashString(entry->id) +
+                " is taken by another source\n";
+        return nullptr;
+    }
+    entries_.splice(entries_.begin(), entries_, entry);
+    digest = entry->digest;
+    return entry->program;
+}
+
+std::shared_ptr<const Program> ProgramCache::find(std::uint64_t id,
+                                                  std::uint64_t& digest)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = index_.find(id);
+    if (it == index_.end())
+        return nullptr;
+    entries_.splice(entries_.begin(), entries_, it->second);
+    digest = it->second->digest;
+    return it->second->program;
+}
+
+std::shared_ptr<const Program> ProgramCache::compile(const std::string& source,
+                                                     std::uint64_t& id,
+                                                     std::uint64_t& digest,
+                                                     std::string& error)
+{
+    id = hashBytes(source);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = index_.find(id);
+        if (it != index_.end())
+            return reuse(it->second, source, digest, error);
+    }
+
+    std::shared_ptr<Program> compiled = std::make_shared<Program>();
+    {
+        std::lock_guard<std::mutex> lock(compileMutex);
+        OptimizerReport report;
+        if (compileSource(source, hashString(id).c_str(), optimize_,
+                          *compiled, &report))
+        {
+            error = err.str();
+            err.str("");
+            err.clear();
+            return nullptr;
+        }
+        digest = ResultCache::digest(*compiled);
+
+        // Reported once per program, as it is compiled
+        std::ostringstream removed;
+        report.print(removed);
+        if (!removed.str().empty())
+            std::cerr << hashString(id) << ":\n" << removed.str();
+    }
+
+    // Another request may have cached the id while this one compiled
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = index_.find(id);
+    if (it != index_.end())
+        return reuse(it->second, source, digest, error);
+    entries_.push_front({id, compiled, digest, source});
+    index_[id] = entries_.begin();
+    size_ += source.size();
+    while (size_ > capacity_ && entries_.size() > 1) {
+        size_ -= entries_.back().source.size();
+        index_.erase(entries_.back().id);
+        entries_.pop_back();
+    }
+    return compiled;
+}
+
+JobServer::JobServer(const char* path, const RunLimits& limits,
+                     unsigned threads, bool optimize, ResultCache* results) :
+    path_(path), limits_(limits), cache_(PROGRAM_CACHE_BYTES, optimize),
+    results_(results), scheduler_(threads), idle_(0), stopping_(false) {}
+
+bool JobServer::run()
+{
+    int fd = listenUnix(path_);
+    if (fd < 0) {
+        err << path_ << ": " << std::strerror(errno) << std::endl;
+        return true;
+    }
+    struct sigaction action;
+    std::memset(&action, 0, sizeof(action));
+    action.sa_handler = interrupt;
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+
+    pollfd pfd = {fd, POLLIN, 0};
+    while (!interrupted) {
+        if (poll(&pfd, 1, POLL_INTERVAL) <= 0)
+            continue;
+        int conn = accept4(fd, nullptr, nullptr, SOCK_CLOEXEC);
+        if (conn < 0)
+            continue;
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending_.push_back(conn);
+        if (pending_.size() > idle_ && workers_.size() < MAX_CONNECTIONS)
+            workers_.emplace_back(&JobServer::work, this);
+        else
+            ready_.notify_one();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+        for (int conn : pending_)
+            close(conn);
+        pending_.clear();
+        for (int conn : active_)
+            shutdown(conn, SHUT_RDWR);
+    }
+    scheduler_.cancelAll();
+    ready_.notify_all();
+    for (std::thread& worker : workers_)
+        worker.join();
+    workers_.clear();
+    close(fd);
+    unlink(path_);
+    return false;
+}
+
+void JobServer::work()
+{
+    do {
+        int conn;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            ++idle_;
+            ready_.wait(lock, [this]() {
+                return stopping_ || !pending_.empty();
+            });
+            --idle_;
+            if (stopping_)
+                return;
+            conn = pending_.front();
+            pending_.pop_front();
+            active_.insert(conn);
+        }
+        SocketStream stream(conn);
+        serve(stream);
+        std::lock_guard<std::mutex> lock(mutex_);
+        active_.erase(conn);
+    } while (true);
+}
+
+void JobServer::serve(SocketStream& stream)
+{
+    std::string header;
+    while (!stream.readLine(header)) {
+        if (handle(stream, header))
+            break;
+    }
+}
+
+/** Sends an error response
+ * @return True, so that the connection is closed
+ */
+static bool fail(SocketStream& stream, const std::string& message)
+{
+    stream.write("ERROR " + std::to_string(message.size()) + '\n' +
+                 message);
+    return true;
+}
+
+/** Returns whether the peer of a connection has closed it. A peer that
+ * only shut down its writing end (e.g. after sending its last request) is
+ * still waiting for the response, so that is not a hang-up
+ */
+static bool hungUp(int fd)
+{
+    pollfd pfd = {fd, 0, 0};
+    return poll(&pfd, 1, 0) > 0 && (pfd.revents & (POLLHUP | POLLERR));
+}
+
+bool JobServer::execute(SocketStream& stream,
+                        std::shared_ptr<const Program> program,
+                        const std::string& input, const RunLimits& limits,
+                        RunResult& result)
+{
+    Scheduler::TaskId task = scheduler_.submit(program, input, limits);
+    TaskState state;
+    while ((state = scheduler_.wait(task, result, POLL_INTERVAL)) ==
+               TaskState::Queued || state == TaskState::Running)
+    {
+        if (interrupted || hungUp(stream.fd()))
+            scheduler_.cancel(task);
+    }
+    return state != TaskState::Finished;
+}
+
+RunLimits JobServer::clamp(std::uint64_t steps, std::size_t cells) const
+{
+    RunLimits limits = limits_;
+    if (steps && steps < limits.steps)
+        limits.steps = steps;
+    if (cells && cells < limits.cells)
+        limits.cells = cells;
+    return limits;
+}
+
+bool JobServer::handle(SocketStream& stream, const std::string& header)
+{
+    std::istringstream ss(header);
+    std::string command, source, input;
+    std::uint64_t steps, id, digest;
+    std::size_t cells, sourceSize = 0, inputSize;
+    std::shared_ptr<const Program> program;
+
+    ss >> command;
+    if (command == "EXEC") {
+        if (!(ss >> steps >> cells >> sourceSize >> inputSize))
+            return fail(stream, "Malformed EXEC request\n");
+    } else if (command == "RUN") {
+        std::string hex;
+        if (!(ss >> hex >> steps >> cells >> inputSize))
+            return fail(stream, "Malformed RUN request\n");
+        id = std::strtoull(hex.c_str(), nullptr, 16);
+    } else
+        return fail(stream, "Unknown command `" + command + "'\n");
+    if (sourceSize > MAX_PAYLOAD || inputSize > MAX_PAYLOAD)
+        return fail(stream, "Request too large\n");
+    if (stream.read(sourceSize, source) || stream.read(inputSize, input))
+        return true;
+
+    if (command == "EXEC") {
+        std::string error;
+        if (!(program = cache_.compile(source, id, digest, error))) {
+            // The request was read completely, so the connection stays up
+            fail(stream, error);
+            return false;
+        }
+    } else if (!(program = cache_.find(id, digest))) {
+        fail(stream, "Unknown program " + hashString(id) + '\n');
+        return false;
+    }
+
+    RunLimits limits = clamp(steps, cells);
+    RunResult result;
+    if (!results_ || results_->find(digest, input, limits, result)) {
+        if (execute(stream, program, input, limits, result))
+            return true;
+        if (results_)
+            results_->store(digest, input, limits, result);
+    }
+    std::ostringstream response;
+    response << "OK " << hashString(id) << ' ' << describe(result.outcome)
+             << ' ' << result.steps << ' ' << result.state << ' '
+             << result.tape.size() << '\n' << result.tape;
+    return stream.write(response.str());
+}
@@ -0,0 +1,184 @@
+#ifndef JOB_SERVER_HPP
+#define JOB_SERVER_HPP
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "ResultCache.hpp"
+#include "Runner.hpp"
+#include "Scheduler.hpp"
+
+class SocketStream;
+
+/** The protocol spoken over the socket. Each request and response is a
+ * header line followed by a payload whose length the header gives, and a
+ * connection may carry any number of requests:
+ *
+ *   EXEC <steps> <cells> <source-length> <input-length>\n<source><input>
+ *   RUN <program-id> <steps> <cells> <input-length>\n<input>
+ *
+ * EXEC compiles the source (or finds it in the cache) and runs it, RUN runs
+ * a program compiled by an earlier EXEC. Limits of zero mean the server's
+ * maximum. The responses are
+ *
+ *   OK <program-id> <outcome> <steps> <state> <tape-length>\n<tape>
+ *   ERROR <message-length>\n<message>
+ */
+
+/** @class ProgramCache
+ * Compiled programs keyed by a hash of their source, evicting the least
+ * recently used programs when their sources exceed the capacity
+ */
+class ProgramCache {
+    /** @struct Entry
+     * A compiled program and its digest (@see ResultCache::digest())
+     */
+    struct Entry {
+        std::uint64_t id;
+        std::shared_ptr<const Program> program;
+        std::uint64_t digest;
+
+        /** The source of the program, compared on a hit since ids can
+         * collide
+         */
+        std::string source;
+    };
+
+    std::mutex mutex_;
+
+    /** The cached programs, most recently used first */
+    std::list<Entry> entries_;
+
+    std::unordered_map<std::uint64_t, std::list<Entry>::iterator> index_;
+
+    /** The number of bytes of the cached sources */
+    std::size_t size_;
+
+    std::size_t capacity_;
+
+    bool optimize_;
+
+    /** Returns the program of a cached entry, marking it as most recently
+     * used, or nullptr if it was compiled from another source
+     * @param digest Set to the digest of the program
+     * @param error Set to the diagnostics if the sources differ
+     * @note Must be called with mutex_ held
+     */
+    std::shared_ptr<const Program> reuse(std::list<Entry>::iterator entry,
+                                         const std::string& source,
+                                         std::uint64_t& digest,
+                                         std::string& error);
+
+public:
+    /** @param capacity The number of bytes of sources to keep, although
+     * the most recently used program is always kept
+     */
+    ProgramCache(std::size_t capacity, bool optimize);
+
+    /** Returns the program with the given id, or nullptr if it is not
+     * cached
+     * @param digest Set to the digest of the program
+     */
+    std::shared_ptr<const Program> find(std::uint64_t id,
+                                        std::uint64_t& digest);
+
+    /** Returns the compiled source, compiling and caching it if it is not
+     * cached yet. A source whose id is that of another cached source is an
+     * error, since RUN requests with the id would run the other program
+     * @param id Set to the id of the program
+     * @param digest Set to the digest of the program
+     * @param error Set to the diagnostics if the source does not compile
+     * or its id is taken
+     * @return The program, or nullptr on error
+     */
+    std::shared_ptr<const Program> compile(const std::string& source,
+                                           std::uint64_t& id,
+                                           std::uint64_t& digest,
+                                           std::string& error);
+};
+
+/** @class JobServer
+ * Serves run requests on a Unix domain socket. Connections are queued for
+ * a pool of connection threads, each of which serves one connection at a
+ * time until the client disconnects. A thread is started when a connection
+ * arrives and no thread is idle, up to a fixed limit. The runs themselves
+ * are tasks of a Scheduler, so a long run only holds a thread for a
+ * quantum at a time and a run is cancelled if its client hangs up. Runs
+ * whose result is in the result cache are not run at all
+ */
+class JobServer {
+    /** The path of the socket */
+    const char* path_;
+
+    /** The largest limits a request may ask for */
+    RunLimits limits_;
+
+    ProgramCache cache_;
+
+    /** The results of earlier runs, or nullptr */
+    ResultCache* results_;
+
+    /** Runs the requests of every connection */
+    Scheduler scheduler_;
+
+    std::mutex mutex_;
+    std::condition_variable ready_;
+
+    /** Accepted connections which are not being served yet */
+    std::deque<int> pending_;
+
+    /** Connections which are being served */
+    std::unordered_set<int> active_;
+
+    /** The connection threads, and how many of them wait for a connection
+     */
+    std::vector<std::thread> workers_;
+    std::size_t idle_;
+
+    bool stopping_;
+
+    /** Runs program on the task scheduler, cancelling the run if the
+     * client hangs up or the server stops
+     * @return True if the run was cancelled, false otherwise
+     */
+    bool execute(SocketStream& stream, std::shared_ptr<const Program> program,
+                 const std::string& input, const RunLimits& limits,
+                 RunResult& result);
+
+    /** Takes connections off the queue and serves them until stopping */
+    void work();
+
+    /** Answers requests on the connection until the client disconnects */
+    void serve(SocketStream& stream);
+
+    /** Answers a single request
+     * @return True if the connection should be closed, false otherwise
+     */
+    bool handle(SocketStream& stream, const std::string& header);
+
+    /** Clamps the requested limits to the server's limits */
+    RunLimits clamp(std::uint64_t steps, std::size_t cells) const;
+
+public:
+    /** @param threads The number of threads that execute runs
+     * @param results The cache to look results up in and add them to, or
+     * nullptr
+     */
+    JobServer(const char* path, const RunLimits& limits, unsigned threads,
+              bool optimize, ResultCache* results = nullptr);
+
+    /** Serves until interrupted by SIGINT or SIGTERM
+     * @return True on failure, false on success
+     */
+    bool run();
+};
+
+#endif /* JOB_SERVER_HPP */
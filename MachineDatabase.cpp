@@ -0,0 +1,111 @@
+#include <algorithm>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "Engine.hpp"
+#include "MachineDatabase.hpp"
+#include "Parallel.hpp"
+#include "StateParser.hpp"
+
+/** The number of records classified as one unit of parallel work */
+constexpr std::size_t RECORDS_PER_BATCH = 4096;
+
+MachineDatabase::MachineDatabase(unsigned states, unsigned symbols,
+                                 std::size_t header) :
+    states_(states), symbols_(symbols), header_(header), data_(nullptr),
+    size_(0) {}
+
+MachineDatabase::~MachineDatabase()
+{
+    if (data_)
+        munmap((void*)data_, size_);
+}
+
+bool MachineDatabase::open(const char* filename)
+{
+    int fd = ::open(filename, O_RDONLY);
+    if (fd < 0) {
+        err << filename << ": No such file" << std::endl;
+        return true;
+    }
+    struct stat st;
+    if (fstat(fd, &st) || (std::size_t)st.st_size < header_) {
+        err << filename << ": Not a machine database" << std::endl;
+        close(fd);
+        return true;
+    }
+    size_ = st.st_size;
+    void* data = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        err << filename << ": Could not map file" << std::endl;
+        size_ = 0;
+        return true;
+    }
+    madvise(data, size_, MADV_SEQUENTIAL);
+    data_ = (const std::uint8_t*)data;
+    if ((size_ - header_) % recordSize()) {
+        err << filename << ": Warning: trailing partial record ignored"
+            << std::endl;
+    }
+    return false;
+}
+
+std::size_t MachineDatabase::recordSize() const
+{
+    return states_ * symbols_ * 3;
+}
+
+std::size_t MachineDatabase::size() const
+{
+    return data_ ? (size_ - header_) / recordSize() : 0;
+}
+
+bool MachineDatabase::decode(std::size_t i, Program& program) const
+{
+    const std::uint8_t* record = data_ + header_ + i * recordSize();
+    for (unsigned s = 0; s < states_; ++s) {
+        for (unsigned c = 0; c < symbols_; ++c, record += 3) {
+            Transition& t = program.at(s, c);
+            if (record[0] >= symbols_ || record[1] > 1 ||
+                record[2] > states_)
+                return true;
+            if (!record[2]) {
+                t = Transition();
+                continue;
+            }
+            t.next = record[2] - 1;
+            t.write = Program::encode(program.alphabet()[record[0]]);
+            t.shift = record[1] ? -1 : 1;
+        }
+    }
+    return false;
+}
+
+BusyBeaverStats MachineDatabase::classify(const BusyBeaverConfig& config) const
+{
+    BusyBeaver beaver(config);
+    std::size_t n = size();
+    std::size_t batches = (n + RECORDS_PER_BATCH - 1) / RECORDS_PER_BATCH;
+    std::vector<BusyBeaverStats> parts(batches);
+    parallelFor(batches, [&](std::size_t b) {
+        Program program = busyBeaverProgram(states_, symbols_);
+        Execution exec(program, config.space);
+        std::size_t end = std::min(n, (b + 1) * RECORDS_PER_BATCH);
+        for (std::size_t i = b * RECORDS_PER_BATCH; i < end; ++i) {
+            if (decode(i, program)) {
+                ++parts[b].malformed;
+                continue;
+            }
+            if (beaver.classify(program, exec, parts[b])) {
+                parts[b].holdouts.push_back(std::to_string(i) + ' ' +
+                                            toCompact(program));
+            }
+        }
+    }, config.threads);
+    BusyBeaverStats total;
+    for (const BusyBeaverStats& part : parts)
+        total.merge(part);
+    return total;
+}
@@ -0,0 +1,63 @@
+#ifndef MACHINE_DATABASE_HPP
+#define MACHINE_DATABASE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include "BusyBeaver.hpp"
+
+/** The size of the header of a bbchallenge-style database */
+constexpr std::size_t DATABASE_HEADER = 30;
+
+/** @class MachineDatabase
+ * A read-only database of busy beaver machines stored as fixed-size binary
+ * records after a header. Each record holds three bytes per (state, symbol)
+ * pair in row-major order: the symbol to write, the direction (0 for right,
+ * 1 for left) and the next state (0 for a missing transition, otherwise the
+ * 1-based state). The file is mapped into memory and records are decoded on
+ * demand straight into a Program
+ */
+class MachineDatabase {
+    unsigned states_, symbols_;
+
+    /** The size of the header to skip */
+    std::size_t header_;
+
+    /** The mapped file, or nullptr if no file is open */
+    const std::uint8_t* data_;
+
+    /** The size of the mapped file */
+    std::size_t size_;
+
+public:
+    MachineDatabase(unsigned states, unsigned symbols,
+                    std::size_t header = DATABASE_HEADER);
+    ~MachineDatabase();
+
+    MachineDatabase(const MachineDatabase&) = delete;
+    MachineDatabase& operator=(const MachineDatabase&) = delete;
+
+    /** Maps the database in the given file
+     * @return True on failure, false on success
+     */
+    bool open(const char* filename);
+
+    /** Returns the size of each record in bytes */
+    std::size_t recordSize() const;
+
+    /** Returns the number of records */
+    std::size_t size() const;
+
+    /** Decodes record i into program, which must come from
+     * busyBeaverProgram() with this database's dimensions
+     * @return True if the record is malformed, false otherwise
+     */
+    bool decode(std::size_t i, Program& program) const;
+
+    /** Runs and classifies every record in parallel. Holdouts are given as
+     * the record index followed by the machine in compact notation, and
+     * malformed records are only counted
+     */
+    BusyBeaverStats classify(const BusyBeaverConfig& config) const;
+};
+
+#endif /* MACHINE_DATABASE_HPP */
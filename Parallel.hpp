@@ -0,0 +1,44 @@
+#ifndef PARALLEL_HPP
+#define PARALLEL_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+/** Returns the number of threads to use when the caller does not specify
+ * one, which is the number of hardware threads (at least one)
+ */
+inline unsigned defaultThreads()
+{
+    unsigned n = std::thread::hardware_concurrency();
+    return n ? n : 1;
+}
+
+/** Calls fn(i) for every i in [0, n), distributing the indices dynamically
+ * over up to the given number of threads (@see defaultThreads() if zero).
+ * The calling thread takes part in the work, so no threads are spawned when
+ * there is only one to use
+ */
+template <typename Function>
+void parallelFor(std::size_t n, Function fn, unsigned threads = 0)
+{
+    if (!threads)
+        threads = defaultThreads();
+    if (threads > n)
+        threads = n;
+    std::atomic<std::size_t> next(0);
+    auto work = [&]() {
+        std::size_t i;
+        while ((i = next++) < n)
+            fn(i);
+    };
+    std::vector<std::thread> pool;
+    for (unsigned i = 1; i < threads; ++i)
+        pool.emplace_back(work);
+    work();
+    for (std::thread& thread : pool)
+        thread.join();
+}
+
+#endif /* PARALLEL_HPP */
@@ -0,0 +1,144 @@
+#include <cstring>
+#include <iomanip>
+#include <linux/perf_event.h>
+#include <string>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "PerfCounters.hpp"
+
+/** The perf configuration and the name of each event */
+static const struct {
+    std::uint64_t config;
+    const char* name;
+} EVENTS[PERF_EVENTS] = {
+    {PERF_COUNT_HW_CPU_CYCLES, "cycles"},
+    {PERF_COUNT_HW_INSTRUCTIONS, "instructions"},
+    {PERF_COUNT_HW_BRANCH_MISSES, "branch-misses"},
+    {PERF_COUNT_HW_CACHE_MISSES, "cache-misses"},
+};
+
+PerfSample::PerfSample() : counts{}, valid{}, seconds(0) {}
+
+PerfSample PerfSample::operator-(const PerfSample& earlier) const
+{
+    PerfSample diff;
+    for (int i = 0; i < PERF_EVENTS; ++i) {
+        diff.valid[i] = valid[i] && earlier.valid[i];
+        diff.counts[i] = counts[i] - earlier.counts[i];
+    }
+    diff.seconds = seconds - earlier.seconds;
+    return diff;
+}
+
+void PerfSample::print(std::ostream& os, std::uint64_t work,
+                       const char* unit) const
+{
+    std::ios::fmtflags flags = os.flags();
+    os << std::fixed << std::setprecision(4);
+    os << "Time:          " << seconds << " s" << std::endl
+       << std::setprecision(2);
+    if (work && seconds > 0) {
+        os << "Rate:          " << work / seconds << ' ' << unit << "s/s"
+           << std::endl
+           << "Latency:       " << seconds * 1e9 / work << " ns/" << unit
+           << std::endl;
+    }
+    bool any = false;
+    for (int i = 0; i < PERF_EVENTS; ++i) {
+        if (!valid[i])
+            continue;
+        any = true;
+        os << std::left << std::setw(15)
+           << (std::string(EVENTS[i].name) + ':') << std::right << counts[i];
+        if (work)
+            os << " (" << (double)counts[i] / work << '/' << unit << ')';
+        os << std::endl;
+    }
+    if (valid[PERF_CYCLES] && valid[PERF_INSTRUCTIONS] &&
+        counts[PERF_CYCLES])
+    {
+        os << "IPC:           "
+           << (double)counts[PERF_INSTRUCTIONS] / counts[PERF_CYCLES]
+           << std::endl;
+    }
+    if (!any)
+        os << "Counters:      unavailable" << std::endl;
+    os.flags(flags);
+}
+
+void PerfSample::printLine(std::ostream& os, std::uint64_t work) const
+{
+    if (!work)
+        work = 1;
+    std::ios::fmtflags flags = os.flags();
+    os << std::fixed << std::setprecision(2) << seconds * 1e9 / work << " ns";
+    for (int i = 0; i < PERF_EVENTS; ++i) {
+        if (valid[i])
+            os << ' ' << (double)counts[i] / work << ' ' << EVENTS[i].name;
+    }
+    os << std::endl;
+    os.flags(flags);
+}
+
+PerfCounters::PerfCounters()
+{
+    for (int i = 0; i < PERF_EVENTS; ++i) {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = EVENTS[i].config;
+        attr.disabled = 1;
+        attr.inherit = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fds_[i] = syscall(SYS_perf_event_open, &attr, 0, -1, -1,
+                          PERF_FLAG_FD_CLOEXEC);
+    }
+}
+
+PerfCounters::~PerfCounters()
+{
+    for (int fd : fds_) {
+        if (fd >= 0)
+            close(fd);
+    }
+}
+
+bool PerfCounters::available() const
+{
+    for (int fd : fds_) {
+        if (fd >= 0)
+            return true;
+    }
+    return false;
+}
+
+void PerfCounters::start()
+{
+    for (int fd : fds_) {
+        if (fd >= 0) {
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+    start_ = std::chrono::steady_clock::now();
+}
+
+PerfSample PerfCounters::read() const
+{
+    PerfSample sample;
+    sample.seconds = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start_).count();
+    for (int i = 0; i < PERF_EVENTS; ++i) {
+        std::uint64_t count;
+        if (fds_[i] >= 0 && ::read(fds_[i], &count, sizeof(count)) ==
+                            sizeof(count))
+        {
+            sample.counts[i] = count;
+            sample.valid[i] = true;
+        }
+    }
+    return sample;
+}
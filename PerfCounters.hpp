@@ -0,0 +1,74 @@
+#ifndef PERF_COUNTERS_HPP
+#define PERF_COUNTERS_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+
+/** The hardware events counted by PerfCounters */
+enum PerfEvent {
+    PERF_CYCLES,
+    PERF_INSTRUCTIONS,
+    PERF_BRANCH_MISSES,
+    PERF_CACHE_MISSES,
+    PERF_EVENTS
+};
+
+/** @struct PerfSample
+ * The counts of hardware events and the wall time over an interval
+ */
+struct PerfSample {
+    std::uint64_t counts[PERF_EVENTS];
+
+    /** Whether each event could be counted */
+    bool valid[PERF_EVENTS];
+
+    double seconds;
+
+    PerfSample();
+
+    /** Returns the counts of this sample minus those of an earlier one */
+    PerfSample operator-(const PerfSample& earlier) const;
+
+    /** Prints the rates of work and of each available event
+     * @param work The amount of work done in the interval, e.g. steps
+     * @param unit The name of one unit of work
+     */
+    void print(std::ostream& os, std::uint64_t work, const char* unit) const;
+
+    /** Prints the time and each available event per unit of work on a
+     * single line
+     */
+    void printLine(std::ostream& os, std::uint64_t work) const;
+};
+
+/** @class PerfCounters
+ * Counts cycles, instructions, branch misses and cache misses in user space
+ * for the calling thread and every thread it creates afterwards, through
+ * perf_event_open(2). Events the kernel or the hardware do not support
+ * (e.g. in a virtual machine, or with perf_event_paranoid set too high) are
+ * left out, and a sample with none of them still has the wall time
+ */
+class PerfCounters {
+    int fds_[PERF_EVENTS];
+
+    std::chrono::steady_clock::time_point start_;
+
+public:
+    PerfCounters();
+    ~PerfCounters();
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    /** Returns whether any event can be counted */
+    bool available() const;
+
+    /** Zeroes the counts and starts counting */
+    void start();
+
+    /** Returns the counts since start(), without stopping */
+    PerfSample read() const;
+};
+
+#endif /* PERF_COUNTERS_HPP */
@@ -0,0 +1,217 @@
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <poll.h>
+#include <signal.h>
+#include <sstream>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "Parallel.hpp"
+#include "ProcessPool.hpp"
+#include "Socket.hpp"
+#include "StateParser.hpp"
+
+static_assert(ATOMIC_LONG_LOCK_FREE == 2,
+              "Counters shared between processes must be lock-free");
+
+/** Runs the inputs claimed from the shared counter until there are none
+ * left, sending each result to stream. shared[0] is the index of the next
+ * input, and shared[1 + slot] is set to one plus the index of the input
+ * being run so that the parent can tell which input a crash took down
+ */
+static void work(const Program& program, const RunLimits& limits,
+                 const std::vector<std::string>& inputs,
+                 std::atomic<std::size_t>* shared, unsigned slot,
+                 SocketStream& stream)
+{
+    std::size_t i;
+    while ((i = shared[0]++) < inputs.size()) {
+        shared[1 + slot] = i + 1;
+        RunResult result = runProgram(program, inputs[i], limits);
+        std::ostringstream os;
+        os << i << ' ' << (int)result.outcome << ' ' << result.steps << ' '
+           << result.state.size() << ' ' << result.tape.size() << '\n'
+           << result.state << result.tape;
+        if (stream.write(os.str()))
+            return;
+        shared[1 + slot] = 0;
+    }
+}
+
+ProcessPool::Worker::Worker() : pid(0), killed(false) {}
+
+ProcessPool::Worker::~Worker() {}
+
+ProcessPool::ProcessPool(const Program& program, const RunLimits& limits,
+                         unsigned processes, std::size_t maxMemory) :
+    program_(program), limits_(limits),
+    processes_(processes ? processes : defaultThreads()),
+    maxMemory_(maxMemory), restarts_(0), kills_(0) {}
+
+bool ProcessPool::spawn(Worker& worker, unsigned slot,
+                        const std::vector<std::string>& inputs,
+                        std::atomic<std::size_t>* shared)
+{
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds))
+        return true;
+    // Output still buffered would be written again by the worker
+    std::cout.flush();
+    pid_t pid = fork();
+    if (pid < 0) {
+        close(fds[0]);
+        close(fds[1]);
+        return true;
+    }
+    if (!pid) {
+        close(fds[0]);
+        {
+            SocketStream stream(fds[1]);
+            work(program_, limits_, inputs, shared, slot, stream);
+        }
+        _exit(0);
+    }
+    close(fds[1]);
+    worker.pid = pid;
+    worker.stream.reset(new SocketStream(fds[0]));
+    worker.killed = false;
+    return false;
+}
+
+bool ProcessPool::receive(Worker& worker, std::vector<RunResult>& results,
+                          std::vector<bool>& done)
+{
+    std::string line, payload;
+    if (worker.stream->readLine(line))
+        return true;
+    std::istringstream ss(line);
+    std::size_t index, stateSize, tapeSize;
+    int outcome;
+    RunResult result;
+    if (!(ss >> index >> outcome >> result.steps >> stateSize >> tapeSize) ||
+        index >= results.size() ||
+        worker.stream->read(stateSize + tapeSize, payload))
+    {
+        kill(worker.pid, SIGKILL);
+        return true;
+    }
+    result.outcome = (Outcome)outcome;
+    result.state = payload.substr(0, stateSize);
+    result.tape = payload.substr(stateSize);
+    results[index] = std::move(result);
+    done[index] = true;
+    return false;
+}
+
+void ProcessPool::checkMemory(std::vector<Worker>& workers)
+{
+    std::size_t page = sysconf(_SC_PAGESIZE);
+    for (Worker& worker : workers) {
+        if (!worker.pid || worker.killed)
+            continue;
+        std::ifstream statm("/proc/" + std::to_string(worker.pid) +
+                            "/statm");
+        std::size_t size, resident;
+        if ((statm >> size >> resident) && resident * page > maxMemory_) {
+            kill(worker.pid, SIGKILL);
+            worker.killed = true;
+        }
+    }
+}
+
+bool ProcessPool::run(const std::vector<std::string>& inputs,
+                      std::vector<RunResult>& results)
+{
+    restarts_ = kills_ = 0;
+    std::size_t n = inputs.size();
+    results.assign(n, RunResult());
+    if (!n)
+        return false;
+    unsigned processes = std::min<std::size_t>(processes_, n);
+    std::size_t bytes = (processes + 1) * sizeof(std::atomic<std::size_t>);
+    void* memory = mmap(nullptr, bytes, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+        err << "Cannot map memory for the workers: " << std::strerror(errno)
+            << std::endl;
+        return true;
+    }
+    std::atomic<std::size_t>* shared = (std::atomic<std::size_t>*)memory;
+    for (unsigned i = 0; i <= processes; ++i)
+        new (&shared[i]) std::atomic<std::size_t>(0);
+
+    std::vector<bool> done(n, false);
+    std::vector<Worker> workers(processes);
+    unsigned alive = 0;
+    for (unsigned w = 0; w < processes; ++w)
+        alive += !spawn(workers[w], w, inputs, shared);
+    if (!alive) {
+        err << "Cannot start the workers: " << std::strerror(errno)
+            << std::endl;
+        munmap(memory, bytes);
+        return true;
+    }
+
+    auto checked = std::chrono::steady_clock::now();
+    while (alive) {
+        std::vector<pollfd> fds;
+        std::vector<unsigned> slots;
+        for (unsigned w = 0; w < processes; ++w) {
+            if (workers[w].pid) {
+                fds.push_back({workers[w].stream->fd(), POLLIN, 0});
+                slots.push_back(w);
+            }
+        }
+        poll(fds.data(), fds.size(), MEMORY_CHECK_INTERVAL);
+        for (std::size_t i = 0; i < fds.size(); ++i) {
+            unsigned w = slots[i];
+            Worker& worker = workers[w];
+            if (!fds[i].revents || !receive(worker, results, done))
+                continue;
+
+            // The worker is gone; the input it was running, if any, took it
+            // down
+            int status;
+            waitpid(worker.pid, &status, 0);
+            worker.pid = 0;
+            worker.stream.reset();
+            --alive;
+            std::size_t running = shared[1 + w].exchange(0);
+            if (running && !done[running - 1]) {
+                results[running - 1].outcome = Outcome::Crashed;
+                results[running - 1].steps = 0;
+                done[running - 1] = true;
+            }
+            if (WIFEXITED(status) && !WEXITSTATUS(status))
+                continue;
+            kills_ += worker.killed;
+            if (shared[0].load() < n && !spawn(worker, w, inputs, shared)) {
+                ++restarts_;
+                ++alive;
+            }
+        }
+        auto now = std::chrono::steady_clock::now();
+        if (maxMemory_ && now - checked >= std::chrono::milliseconds(
+                                               MEMORY_CHECK_INTERVAL))
+        {
+            checkMemory(workers);
+            checked = now;
+        }
+    }
+    munmap(memory, bytes);
+
+    // Inputs claimed by a worker that died before it could mark them
+    for (std::size_t i = 0; i < n; ++i) {
+        if (!done[i]) {
+            results[i].outcome = Outcome::Crashed;
+            results[i].steps = 0;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,102 @@
+#ifndef PROCESS_POOL_HPP
+#define PROCESS_POOL_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+#include "Runner.hpp"
+
+class SocketStream;
+
+/** The number of milliseconds between checks of the workers' memory */
+#ifdef POOL_MEMORY_CHECK_MS
+constexpr int MEMORY_CHECK_INTERVAL = POOL_MEMORY_CHECK_MS;
+#else
+constexpr int MEMORY_CHECK_INTERVAL = 50;
+#endif /* POOL_MEMORY_CHECK_MS */
+
+/** @class ProcessPool
+ * Runs a program on many inputs in forked worker processes, so that a
+ * worker that crashes or grows too large takes down only the input it was
+ * running. The workers inherit the program and the inputs copy-on-write,
+ * so they share the parent's pages rather than copying them, and claim
+ * inputs from a counter in shared memory. Each worker sends its results
+ * back over a socket, since results vary in size. A worker that dies is
+ * restarted while inputs remain, and the input it was running is reported
+ * as Outcome::Crashed
+ */
+class ProcessPool {
+    /** @struct Worker
+     * A worker process, as the parent sees it
+     */
+    struct Worker {
+        pid_t pid;
+
+        /** The parent's end of the worker's socket */
+        std::unique_ptr<SocketStream> stream;
+
+        /** Whether the parent killed the worker for its memory use */
+        bool killed;
+
+        Worker();
+        ~Worker();
+    };
+
+    const Program& program_;
+    RunLimits limits_;
+    unsigned processes_;
+
+    /** The most resident memory a worker may use in bytes, or zero */
+    std::size_t maxMemory_;
+
+    /** The number of workers restarted and killed during the last run */
+    unsigned restarts_, kills_;
+
+    /** Forks a worker for the given slot of shared
+     * @return True on failure, false on success
+     */
+    bool spawn(Worker& worker, unsigned slot,
+               const std::vector<std::string>& inputs,
+               std::atomic<std::size_t>* shared);
+
+    /** Receives one result from a worker into results
+     * @return True if the worker closed its socket, false otherwise
+     */
+    bool receive(Worker& worker, std::vector<RunResult>& results,
+                 std::vector<bool>& done);
+
+    /** Kills the workers whose resident memory exceeds maxMemory_ */
+    void checkMemory(std::vector<Worker>& workers);
+
+public:
+    /** @param processes The number of workers (@see defaultThreads() if
+     * zero)
+     * @param maxMemory The most resident memory a worker may use in bytes,
+     * or zero for no limit
+     */
+    ProcessPool(const Program& program, const RunLimits& limits,
+                unsigned processes = 0, std::size_t maxMemory = 0);
+
+    /** Runs the program on every input
+     * @param results Set to the results in the order of the inputs
+     * @return True if no worker could be started (with diagnostics in
+     * err), false otherwise
+     * @note Must be called while the process has no other threads, since
+     * the workers are forked
+     */
+    bool run(const std::vector<std::string>& inputs,
+             std::vector<RunResult>& results);
+
+    /** Returns the number of workers restarted during the last run */
+    unsigned restarts() const { return restarts_; }
+
+    /** Returns the number of workers killed for their memory use during the
+     * last run
+     */
+    unsigned kills() const { return kills_; }
+};
+
+#endif /* PROCESS_POOL_HPP */
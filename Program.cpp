@@ -0,0 +1,172 @@
+#include <unordered_map>
+#include "Program.hpp"
+#include "StateRegister.hpp"
+
+Transition::Transition() :
+    next(NO_STATE), write(0), shift(0), flags(0), keep(0) {}
+
+/** Returns the head movement for a shift of a rule */
+static std::int8_t direction(char shift)
+{
+    return shift == 'L' ? -1 : shift == 'R' ? 1 : 0;
+}
+
+Program::Program() : states_(0), alphabet_(1, BLANK)
+{
+    init();
+}
+
+Program::Program(const std::vector<std::string>& labels,
+                 const std::string& alphabet) :
+    states_(labels.size()), alphabet_(alphabet), labels_(labels)
+{
+    if (alphabet_.empty() || alphabet_[0] != BLANK)
+        alphabet_.insert(alphabet_.begin(), BLANK);
+    init();
+}
+
+Program::Program(const StateRegister& reg) : states_(0)
+{
+    bool seen[256] = {false};
+    alphabet_.push_back(BLANK);
+    seen[(unsigned char)BLANK] = true;
+    for (const State& state : reg.states_) {
+        ++states_;
+        labels_.push_back(state.label);
+        for (const Action& action : state.table) {
+            // A default action needs a column for each symbol it skips
+            std::string syms = action.sym == ANY ? action.except
+                                                 : std::string(1, action.sym);
+            if (action.replace != ANY)
+                syms.push_back(action.replace);
+            for (char sym : syms) {
+                if (!seen[(unsigned char)sym]) {
+                    seen[(unsigned char)sym] = true;
+                    alphabet_.push_back(sym);
+                }
+            }
+        }
+    }
+    init();
+
+    std::unordered_map<const State*, std::uint32_t> ids;
+    for (const State& state : reg.states_)
+        ids.emplace(&state, ids.size());
+    std::uint32_t id = 0;
+    for (const State& state : reg.states_) {
+        final_[id] = state.final;
+        for (const Action& action : state.table) {
+            if (action.sym == ANY)
+                continue;
+            Transition& t = at(id, column(encode(action.sym)));
+            if (t.next != NO_STATE) // Only the first match is ever used
+                continue;
+            t.next = ids[action.target];
+            t.write = encode(action.replace);
+            t.shift = direction(action.shift);
+        }
+        // The default action fills every column left, including the one for
+        // unknown symbols
+        const Action* fallback = state.fallback();
+        for (std::uint32_t c = 0; fallback && c < columns_; ++c) {
+            Transition& t = at(id, c);
+            bool other = c + 1 == columns_;
+            if (t.next != NO_STATE ||
+                (!other && !fallback->matches(alphabet_[c])))
+            {
+                continue;
+            }
+            t.next = ids[fallback->target];
+            t.shift = direction(fallback->shift);
+            if (fallback->replace != ANY)
+                t.write = encode(fallback->replace);
+            else if (!other)
+                t.write = encode(alphabet_[c]);
+            else
+                t.keep = 0xFF;
+        }
+        ++id;
+    }
+    findSweeps();
+}
+
+void Program::init()
+{
+    columns_ = alphabet_.size() + 1;
+    for (unsigned i = 0; i < 256; ++i)
+        column_[i] = columns_ - 1;
+    for (std::size_t i = 0; i < alphabet_.size(); ++i)
+        column_[encode(alphabet_[i])] = i;
+    table_.assign(states_ * columns_, Transition());
+    final_.assign(states_, false);
+    labels_.resize(states_);
+    sweeps_.assign(states_, SweepSet());
+}
+
+void Program::findSweeps()
+{
+    for (std::uint32_t s = 0; s < states_; ++s) {
+        SweepSet sweep;
+        int shift = 0;
+        bool mixed = false;
+        for (std::uint32_t c = 0; c < columns_; ++c) {
+            Transition& t = at(s, c);
+            t.flags &= ~SWEEP;
+            if (t.next != s || !t.shift ||
+                (!t.keep && (c + 1 == columns_ ||
+                             t.write != encode(alphabet_[c]))))
+            {
+                continue;
+            }
+            mixed |= shift && shift != t.shift;
+            shift = t.shift;
+            for (unsigned cell = 0; cell < 256; ++cell) {
+                if (column_[cell] == c)
+                    sweep.insert(cell);
+            }
+            t.flags |= SWEEP;
+        }
+        if (mixed) {
+            sweep = SweepSet();
+            for (std::uint32_t c = 0; c < columns_; ++c)
+                at(s, c).flags &= ~SWEEP;
+        }
+        sweeps_[s] = sweep;
+    }
+}
+
+void Program::renumber(const std::vector<std::uint32_t>& order)
+{
+    std::vector<std::uint32_t> id(states_);
+    for (std::uint32_t i = 0; i < states_; ++i)
+        id[order[i]] = i;
+    std::vector<Transition> table(table_.size());
+    std::vector<char> final(states_);
+    std::vector<std::string> labels(states_);
+    std::vector<SweepSet> sweeps(states_);
+    for (std::uint32_t i = 0; i < states_; ++i) {
+        std::uint32_t old = order[i];
+        for (std::uint32_t c = 0; c < columns_; ++c) {
+            Transition t = at(old, c);
+            if (t.next != NO_STATE)
+                t.next = id[t.next];
+            table[i * columns_ + c] = t;
+        }
+        final[i] = final_[old];
+        labels[i] = std::move(labels_[old]);
+        sweeps[i] = sweeps_[old];
+    }
+    table_.swap(table);
+    final_.swap(final);
+    labels_.swap(labels);
+    sweeps_.swap(sweeps);
+}
+
+std::uint32_t Program::find(const std::string& label) const
+{
+    for (std::uint32_t i = 0; i < states_; ++i) {
+        if (labels_[i] == label)
+            return i;
+    }
+    return NO_STATE;
+}
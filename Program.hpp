@@ -0,0 +1,165 @@
+#ifndef PROGRAM_HPP
+#define PROGRAM_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Sweep.hpp"
+#include "Tape.hpp"
+
+class StateRegister;
+
+/** Marks a transition that does not exist, i.e., the machine stops */
+constexpr std::uint32_t NO_STATE = 0xFFFFFFFF;
+
+/** Transition flag: the transition loops to its own state, rewriting the
+ * symbol it read, so the engine may skip over every following cell on
+ * which the state loops the same way (@see Program::sweep())
+ */
+constexpr std::uint8_t SWEEP = 1;
+
+/** @struct Transition
+ * One entry of a compiled transition table
+ */
+struct Transition {
+    /** The state to move to, or NO_STATE if there is no applicable rule */
+    std::uint32_t next;
+
+    /** The encoded symbol to write (@see Program::encode()) */
+    std::uint8_t write;
+
+    /** The head movement: -1 for left, +1 for right or 0 to stay */
+    std::int8_t shift;
+
+    /** A combination of transition flags (e.g. SWEEP) */
+    std::uint8_t flags;
+
+    /** The bits of the cell read that are kept, ORed with write: 0xFF for a
+     * rule that writes back whatever it read (write is then zero), so that
+     * the column of unknown symbols can keep them
+     */
+    std::uint8_t keep;
+
+    Transition();
+};
+
+/** @class Program
+ * A finite state machine compiled into a dense transition table which is
+ * indexed by state id and column. Tape cells hold encoded symbols, which are
+ * mapped to columns through a 256-entry table so that symbols the program
+ * never mentions share a single column, whose only transitions are the
+ * default actions of states (@see ANY)
+ */
+class Program {
+    /** The number of states */
+    std::uint32_t states_;
+
+    /** The number of columns (the alphabet plus the column for unknown
+     * symbols)
+     */
+    std::uint32_t columns_;
+
+    /** The column of each encoded symbol */
+    std::uint8_t column_[256];
+
+    /** The symbol of each column except the last, with the blank first */
+    std::string alphabet_;
+
+    /** The transition table in row-major order (states_ x columns_) */
+    std::vector<Transition> table_;
+
+    /** Whether each state is final (accepting) */
+    std::vector<char> final_;
+
+    /** The label of each state */
+    std::vector<std::string> labels_;
+
+    /** The symbols each state sweeps over; @see findSweeps() */
+    std::vector<SweepSet> sweeps_;
+
+    /** Sets up the column mapping for alphabet_ and an empty table */
+    void init();
+
+public:
+    /** Creates a program without any states */
+    Program();
+
+    /** Creates a program with the given states and alphabet and no
+     * transitions. The blank is added to the front of the alphabet if it is
+     * not already there
+     */
+    Program(const std::vector<std::string>& labels,
+            const std::string& alphabet);
+
+    /** Compiles the resolved states of the given register. The initial state
+     * always gets id zero
+     */
+    explicit Program(const StateRegister& reg);
+
+    /** Returns the encoding of a symbol on a tape cell; the blank is zero */
+    static std::uint8_t encode(char sym) { return sym ^ BLANK; }
+
+    /** Returns the symbol for an encoded tape cell */
+    static char decode(std::uint8_t cell) { return cell ^ BLANK; }
+
+    std::uint32_t states() const { return states_; }
+    std::uint32_t columns() const { return columns_; }
+
+    /** Returns the symbols known to this program, blank first */
+    const std::string& alphabet() const { return alphabet_; }
+
+    /** Returns the column for the given encoded cell */
+    std::uint8_t column(std::uint8_t cell) const { return column_[cell]; }
+
+    /** Returns the column mapping; @see column() */
+    const std::uint8_t* columnMap() const { return column_; }
+
+    /** Returns the transition table; @see at() */
+    const Transition* table() const { return table_.data(); }
+
+    /** Returns the transition for the given state and column */
+    const Transition& at(std::uint32_t state, std::uint32_t column) const
+    {
+        return table_[state * columns_ + column];
+    }
+
+    Transition& at(std::uint32_t state, std::uint32_t column)
+    {
+        return table_[state * columns_ + column];
+    }
+
+    bool final(std::uint32_t state) const { return final_[state]; }
+    void setFinal(std::uint32_t state, bool final) { final_[state] = final; }
+
+    const std::string& label(std::uint32_t state) const
+    {
+        return labels_[state];
+    }
+
+    /** Detects sweep states: states that loop to themselves, rewriting the
+     * symbol read and moving in a single direction, on some set of symbols,
+     * which includes every unknown symbol if the default action loops. The
+     * looping transitions get the SWEEP flag
+     * @note Called automatically when compiling a register; must be called
+     * again after changing transitions
+     */
+    void findSweeps();
+
+    /** Returns the symbols the given state sweeps over */
+    const SweepSet& sweep(std::uint32_t state) const
+    {
+        return sweeps_[state];
+    }
+
+    /** Moves the states to new ids: the state with id order[i] gets id i.
+     * Transitions are updated to the new ids, so the program behaves the
+     * same. order must be a permutation of the ids with order[0] zero,
+     * since the initial state always has id zero
+     */
+    void renumber(const std::vector<std::uint32_t>& order);
+
+    /** Returns the id of the state with the given label, or NO_STATE */
+    std::uint32_t find(const std::string& label) const;
+};
+
+#endif /* PROGRAM_HPP */
@@ -0,0 +1,224 @@
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "Hash.hpp"
+#include "ResultCache.hpp"
+#include "StateRegister.hpp"
+
+/** The first line of every result file */
+static const char* const MAGIC = "turing-result 1";
+
+/** Compresses data with PackBits: a control byte below 128 is followed by
+ * that many plus one literal bytes, and a control byte c of 128 or more by
+ * a byte which is repeated c - 126 times. Tapes are mostly long runs of the
+ * same symbol, which this shrinks by a factor of up to 64
+ */
+static std::string packRuns(const std::string& data)
+{
+    std::string packed;
+    std::size_t i = 0, n = data.size();
+    while (i < n) {
+        std::size_t run = 1;
+        while (i + run < n && run < 129 && data[i + run] == data[i])
+            ++run;
+        if (run >= 2) {
+            packed.push_back((char)(run + 126));
+            packed.push_back(data[i]);
+            i += run;
+            continue;
+        }
+        // Copy literals up to the next run of three
+        std::size_t begin = i;
+        while (i < n && i - begin < 128) {
+            if (i + 2 < n && data[i] == data[i + 1] && data[i] == data[i + 2])
+                break;
+            ++i;
+        }
+        packed.push_back((char)(i - begin - 1));
+        packed.append(data, begin, i - begin);
+    }
+    return packed;
+}
+
+/** Expands data compressed by packRuns()
+ * @return True if the data is malformed, false otherwise
+ */
+static bool unpackRuns(const std::string& packed, std::string& data)
+{
+    std::size_t i = 0;
+    data.clear();
+    while (i < packed.size()) {
+        unsigned char c = packed[i++];
+        if (c < 128) {
+            if (packed.size() - i < (std::size_t)c + 1)
+                return true;
+            data.append(packed, i, c + 1);
+            i += c + 1;
+        } else {
+            if (i == packed.size())
+                return true;
+            data.append(c - 126, packed[i++]);
+        }
+    }
+    return false;
+}
+
+/** Finds the outcome with the given name (@see describe())
+ * @return True if there is none, false otherwise
+ */
+static bool parseOutcome(const std::string& name, Outcome& outcome)
+{
+    for (Outcome o : {Outcome::Accepted, Outcome::Jammed, Outcome::StepLimit,
+                      Outcome::OutOfMemory})
+    {
+        if (name == describe(o)) {
+            outcome = o;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ResultCache::Key::operator==(const Key& other) const
+{
+    return program == other.program && steps == other.steps &&
+           cells == other.cells && input == other.input;
+}
+
+std::uint64_t ResultCache::Key::hash() const
+{
+    std::uint64_t hash = hashBytes(&program, sizeof(program));
+    hash = hashBytes(&steps, sizeof(steps), hash);
+    hash = hashBytes(&cells, sizeof(cells), hash);
+    return hashBytes(input, hash);
+}
+
+ResultCache::ResultCache(const std::string& dir, std::size_t capacity) :
+    dir_(dir), size_(0), capacity_(capacity)
+{
+    mkdir(dir_.c_str(), 0777);
+}
+
+std::uint64_t ResultCache::digest(const Program& program)
+{
+    StateRegister reg;
+    reg.parser().addStates(program, "");
+    return hashBytes(reg.transcript());
+}
+
+std::string ResultCache::path(std::uint64_t hash) const
+{
+    std::string name = hashString(hash);
+    return dir_ + '/' + name.substr(0, 2) + '/' + name.substr(2);
+}
+
+bool ResultCache::load(const Key& key, RunResult& result) const
+{
+    std::ifstream file(path(key.hash()), std::ios::binary);
+    if (!file.is_open())
+        return true;
+    std::string magic, header, program, outcome;
+    std::uint64_t steps;
+    std::size_t cells, inputSize, stateSize, tapeSize;
+    std::getline(file, magic);
+    std::getline(file, header);
+    std::istringstream ss(header);
+    if (magic != MAGIC ||
+        !(ss >> program >> steps >> cells >> outcome >> result.steps >>
+          inputSize >> stateSize >> tapeSize) ||
+        program != hashString(key.program) || steps != key.steps ||
+        cells != key.cells || parseOutcome(outcome, result.outcome))
+    {
+        return true;
+    }
+    std::string payload((std::istreambuf_iterator<char>(file)),
+                        std::istreambuf_iterator<char>());
+    std::string input;
+    if (payload.size() != inputSize + stateSize + tapeSize ||
+        unpackRuns(payload.substr(0, inputSize), input) ||
+        input != key.input ||
+        unpackRuns(payload.substr(inputSize + stateSize), result.tape))
+    {
+        return true;
+    }
+    result.state = payload.substr(inputSize, stateSize);
+    return false;
+}
+
+bool ResultCache::save(const Key& key, const RunResult& result) const
+{
+    static std::atomic<unsigned> counter(0);
+    std::string target = path(key.hash());
+    mkdir(target.substr(0, target.rfind('/')).c_str(), 0777);
+    std::string temp = target + ".tmp" + std::to_string(getpid()) + '.' +
+                       std::to_string(counter++);
+    std::string input = packRuns(key.input), tape = packRuns(result.tape);
+    {
+        std::ofstream file(temp, std::ios::binary);
+        file << MAGIC << '\n' << hashString(key.program) << ' ' << key.steps
+             << ' ' << key.cells << ' ' << describe(result.outcome) << ' '
+             << result.steps << ' ' << input.size() << ' '
+             << result.state.size() << ' ' << tape.size() << '\n'
+             << input << result.state << tape;
+        if (!file.flush()) {
+            std::remove(temp.c_str());
+            return true;
+        }
+    }
+    // Readers see either no file or a complete one
+    if (std::rename(temp.c_str(), target.c_str())) {
+        std::remove(temp.c_str());
+        return true;
+    }
+    return false;
+}
+
+void ResultCache::remember(const Key& key, const RunResult& result)
+{
+    std::uint64_t hash = key.hash();
+    if (index_.count(hash))
+        return;
+    entries_.emplace_front(key, result);
+    index_[hash] = entries_.begin();
+    size_ += key.input.size() + result.state.size() + result.tape.size();
+    while (size_ > capacity_ && !entries_.empty()) {
+        const Entry& last = entries_.back();
+        size_ -= last.first.input.size() + last.second.state.size() +
+                 last.second.tape.size();
+        index_.erase(last.first.hash());
+        entries_.pop_back();
+    }
+}
+
+bool ResultCache::find(std::uint64_t program, const std::string& input,
+                       const RunLimits& limits, RunResult& result)
+{
+    Key key = {program, input, limits.steps, limits.cells};
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = index_.find(key.hash());
+        if (it != index_.end() && it->second->first == key) {
+            entries_.splice(entries_.begin(), entries_, it->second);
+            result = it->second->second;
+            return false;
+        }
+    }
+    if (load(key, result))
+        return true;
+    std::lock_guard<std::mutex> lock(mutex_);
+    remember(key, result);
+    return false;
+}
+
+void ResultCache::store(std::uint64_t program, const std::string& input,
+                        const RunLimits& limits, const RunResult& result)
+{
+    Key key = {program, input, limits.steps, limits.cells};
+    save(key, result);
+    std::lock_guard<std::mutex> lock(mutex_);
+    remember(key, result);
+}
@@ -0,0 +1,113 @@
+#ifndef RESULT_CACHE_HPP
+#define RESULT_CACHE_HPP
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include "Runner.hpp"
+
+/** The number of bytes of results a ResultCache keeps in memory */
+#ifdef RESULT_CACHE_BYTES
+constexpr std::size_t MAX_CACHED_BYTES = RESULT_CACHE_BYTES;
+#else
+constexpr std::size_t MAX_CACHED_BYTES = 64 << 20;
+#endif /* RESULT_CACHE_BYTES */
+
+/** @class ResultCache
+ * Results of headless runs, keyed by the program, the input and the limits
+ * of the run. Results are stored in a directory with one file per run,
+ * which is written to a temporary file and renamed into place so that any
+ * number of processes may share the directory, and the most recently used
+ * results are kept in memory as well. A file also holds its key, so two
+ * keys whose files share a name, or a damaged file, are a miss rather than
+ * a wrong result. Programs are only told apart by their 64-bit digest,
+ * though, so two programs whose digests collide share results
+ */
+class ResultCache {
+    /** @struct Key
+     * What a run's result depends on
+     */
+    struct Key {
+        /** @see digest() */
+        std::uint64_t program;
+        std::string input;
+        std::uint64_t steps;
+        std::size_t cells;
+
+        bool operator==(const Key& other) const;
+
+        /** Returns the hash that names the key's file */
+        std::uint64_t hash() const;
+    };
+
+    typedef std::pair<Key, RunResult> Entry;
+
+    /** The directory of the files */
+    std::string dir_;
+
+    std::mutex mutex_;
+
+    /** The results in memory, most recently used first */
+    std::list<Entry> entries_;
+
+    std::unordered_map<std::uint64_t, std::list<Entry>::iterator> index_;
+
+    /** The number of bytes of the results in memory */
+    std::size_t size_;
+
+    std::size_t capacity_;
+
+    /** Returns the path of the file for the given key hash */
+    std::string path(std::uint64_t hash) const;
+
+    /** Reads the result for key from its file
+     * @return True if there is no valid file, false otherwise
+     */
+    bool load(const Key& key, RunResult& result) const;
+
+    /** Writes the result for key to its file
+     * @return True on failure, false on success
+     */
+    bool save(const Key& key, const RunResult& result) const;
+
+    /** Adds a result to the results in memory, evicting the least recently
+     * used ones to stay within capacity
+     * @note Must be called with mutex_ held
+     */
+    void remember(const Key& key, const RunResult& result);
+
+public:
+    /** Uses the given directory, which is created if it does not exist
+     * @param capacity The number of bytes of results to keep in memory
+     */
+    explicit ResultCache(const std::string& dir,
+                         std::size_t capacity = MAX_CACHED_BYTES);
+
+    /** Returns a digest of the program's canonical form: the transcript
+     * (@see StateParser::repr()) of the states the compiled table
+     * describes. Sources that differ only in spacing or in shadowed rules
+     * compile to the same table and share results, but reordering rules
+     * may not, since the columns of the table follow the order in which
+     * symbols are first mentioned
+     */
+    static std::uint64_t digest(const Program& program);
+
+    /** Looks up the result of a run
+     * @param program The digest of the program
+     * @return True if the result is not cached, false otherwise
+     */
+    bool find(std::uint64_t program, const std::string& input,
+              const RunLimits& limits, RunResult& result);
+
+    /** Caches the result of a run. Failing to write the file is not an
+     * error; the result is still kept in memory
+     * @param program The digest of the program
+     */
+    void store(std::uint64_t program, const std::string& input,
+               const RunLimits& limits, const RunResult& result);
+};
+
+#endif /* RESULT_CACHE_HPP */
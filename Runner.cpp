@@ -0,0 +1,209 @@
+#include <algorithm>
+#include <utility>
+#include "Diagram.hpp"
+#include "PerfCounters.hpp"
+#include "Runner.hpp"
+#include "StateOptimizer.hpp"
+#include "StateRegister.hpp"
+
+RunLimits::RunLimits() : steps(UINT64_MAX), cells(MAX_FLAT_CELLS) {}
+
+void RunResult::print(std::ostream& os) const
+{
+    os << "Outcome: " << describe(outcome) << std::endl
+       << "Steps:   " << steps << std::endl
+       << "State:   " << state << std::endl
+       << "Tape:    " << tape << std::endl;
+}
+
+void RunResult::printLine(std::ostream& os) const
+{
+    os << describe(outcome) << ' ' << steps << ' ' << state << ' ' << tape
+       << '\n';
+}
+
+TierSteps::TierSteps() : interpreted(0), compiled(0), swept(0) {}
+
+void TierSteps::print(std::ostream& os) const
+{
+    os << "Tiers:   " << interpreted << " interpreted, " << compiled
+       << " compiled, " << swept << " swept" << std::endl;
+}
+
+/** Optimizes a register that has been parsed, if requested
+ * @param report Set to what the optimizer removed, unless nullptr
+ */
+static void optimizeRegister(StateRegister& reg, bool optimize,
+                             OptimizerReport* report)
+{
+    if (!optimize)
+        return;
+    OptimizerReport removed = StateOptimizer(reg).optimize();
+    if (report)
+        *report = std::move(removed);
+}
+
+bool parseFiles(int num, const char* filenames[], bool optimize,
+                StateRegister& reg, OptimizerReport* report)
+{
+    if (reg.parser().addStates(num, filenames))
+        return true;
+    optimizeRegister(reg, optimize, report);
+    return false;
+}
+
+bool compileFiles(int num, const char* filenames[], bool optimize,
+                  Program& program, OptimizerReport* report)
+{
+    StateRegister reg;
+    if (parseFiles(num, filenames, optimize, reg, report))
+        return true;
+    program = Program(reg);
+    return false;
+}
+
+bool compileSource(const std::string& source, const char* name,
+                   bool optimize, Program& program, OptimizerReport* report)
+{
+    StateRegister reg;
+    if (reg.parser().addSource(source, name))
+        return true;
+    optimizeRegister(reg, optimize, report);
+    program = Program(reg);
+    return false;
+}
+
+RunResult summarize(const Execution& exec, Outcome outcome)
+{
+    RunResult result;
+    result.outcome = outcome;
+    result.steps = exec.steps();
+    result.state = exec.program().label(exec.state());
+    result.tape = exec.tape().contents();
+    return result;
+}
+
+RunResult runProgram(const Program& program, const std::string& input,
+                     const RunLimits& limits)
+{
+    Execution exec(program, limits.cells);
+    exec.reset(input.c_str());
+    return summarize(exec, exec.run(limits.steps));
+}
+
+RunResult runTiered(StateRegister& reg, const std::string& input,
+                    const RunLimits& limits, TierSteps& tiers)
+{
+    FlatTape tape(limits.cells);
+    tape.write(input.c_str());
+    reg.reset();
+    std::uint64_t budget = std::min(limits.steps,
+                                    std::max(TIER_SAMPLE,
+                                             TIER_UP_STEPS * reg.states()));
+
+    // Loop steps are the steps a compiled program could sweep over (@see
+    // Program::findSweeps()): a rule that keeps the symbol, moves the head
+    // and stays in its state. Entries count the loops they form
+    std::uint64_t n = 0, loopSteps = 0, loopEntries = 0;
+    bool looping = false;
+    Outcome outcome = Outcome::StepLimit;
+    for (; n < budget; ++n) {
+        const char* state = reg.getState();
+        char sym = Program::decode(tape.head());
+        int r = reg.handle(sym);
+        if (r < 0) {
+            outcome = reg.onFinal() ? Outcome::Accepted : Outcome::Jammed;
+            break;
+        }
+        char write = (char)(r >> 8), shift = r & 0xFF;
+        int move = shift == 'L' ? -1 : shift == 'R' ? 1 : 0;
+        bool loop = move && write == sym && reg.getState() == state;
+        loopSteps += loop;
+        loopEntries += loop && !looping;
+        looping = loop;
+        tape.head() = Program::encode(write);
+        if (tape.move(move)) {
+            // The step counts, as it does in Engine::run()
+            ++n;
+            outcome = Outcome::OutOfMemory;
+            break;
+        }
+    }
+    tiers.interpreted = n;
+    tiers.compiled = tiers.swept = 0;
+    if (outcome != Outcome::StepLimit || n == limits.steps) {
+        RunResult result;
+        result.outcome = outcome;
+        result.steps = n;
+        result.state = reg.getState();
+        result.tape = tape.contents();
+        return result;
+    }
+
+    // The run is long enough to pay for compiling
+    Program program(reg);
+    Execution exec(program, limits.cells);
+    exec.resume(tape, program.find(reg.getState()), n);
+    std::uint64_t steps = limits.steps == UINT64_MAX ? UINT64_MAX
+                                                     : limits.steps - n;
+    if (loopSteps >= TIER_SWEEP_LOOP * loopEntries) {
+        outcome = exec.run(steps);
+        tiers.swept = exec.steps() - n;
+    } else {
+        NoSweeps observer;
+        outcome = exec.run(steps, observer);
+        tiers.compiled = exec.steps() - n;
+    }
+    return summarize(exec, outcome);
+}
+
+RunResult profileProgram(const Program& program, const std::string& input,
+                         const RunLimits& limits, std::uint64_t batch,
+                         std::ostream& os)
+{
+    Execution exec(program, limits.cells);
+    exec.reset(input.c_str());
+    PerfCounters counters;
+    if (!counters.available())
+        os << "Hardware performance counters are unavailable" << std::endl;
+    if (!batch)
+        batch = limits.steps;
+
+    Outcome outcome;
+    counters.start();
+    PerfSample last = counters.read();
+    do {
+        std::uint64_t begin = exec.steps();
+        outcome = exec.run(std::min(batch, limits.steps - begin));
+        if (batch < limits.steps) {
+            PerfSample sample = counters.read();
+            os << "Steps " << begin << '-' << exec.steps() << ": ";
+            (sample - last).printLine(os, exec.steps() - begin);
+            last = sample;
+        }
+    } while (outcome == Outcome::StepLimit && exec.steps() < limits.steps);
+    counters.read().print(os, exec.steps(), "step");
+    return summarize(exec, outcome);
+}
+
+RunResult drawProgram(const Program& program, const std::string& input,
+                      const RunLimits& limits, SpaceTimeDiagram& diagram)
+{
+    Execution exec(program, limits.cells);
+    exec.reset(input.c_str());
+    if (!input.empty())
+        diagram.cover((long)input.size() - 1);
+    diagram.sample(exec.tape());
+
+    // The engine runs uninterrupted between samples, so drawing costs
+    // little more than a plain run once the interval has grown
+    Outcome outcome;
+    do {
+        std::uint64_t begin = exec.steps();
+        outcome = exec.run(std::min(diagram.interval(),
+                                    limits.steps - begin));
+        if (exec.steps() != begin)
+            diagram.sample(exec.tape());
+    } while (outcome == Outcome::StepLimit && exec.steps() < limits.steps);
+    return summarize(exec, outcome);
+}
@@ -0,0 +1,156 @@
+#ifndef RUNNER_HPP
+#define RUNNER_HPP
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include "Engine.hpp"
+
+class SpaceTimeDiagram;
+struct OptimizerReport;
+
+/** The number of steps per state of a program that runTiered() interprets
+ * before compiling the program, by which time interpreting has cost about
+ * as much as compiling
+ */
+#ifdef TIER_UP_STEPS_PER_STATE
+constexpr std::uint64_t TIER_UP_STEPS = TIER_UP_STEPS_PER_STATE;
+#else
+constexpr std::uint64_t TIER_UP_STEPS = 2;
+#endif /* TIER_UP_STEPS_PER_STATE */
+
+/** The fewest steps runTiered() interprets before compiling, so that it has
+ * seen enough of the run to choose how to run the compiled program
+ */
+#ifdef TIER_SAMPLE_STEPS
+constexpr std::uint64_t TIER_SAMPLE = TIER_SAMPLE_STEPS;
+#else
+constexpr std::uint64_t TIER_SAMPLE = 256;
+#endif /* TIER_SAMPLE_STEPS */
+
+/** The average number of steps a loop must take each time a state enters
+ * it for runTiered() to run the compiled program with sweeps (@see SWEEP).
+ * A sweep skips all but the first step of a loop at the cost of scanning
+ * the tape, so sweeping over shorter loops is slower than stepping
+ */
+#ifdef TIER_SWEEP_LOOP_STEPS
+constexpr std::uint64_t TIER_SWEEP_LOOP = TIER_SWEEP_LOOP_STEPS;
+#else
+constexpr std::uint64_t TIER_SWEEP_LOOP = 3;
+#endif /* TIER_SWEEP_LOOP_STEPS */
+
+/** @struct RunLimits
+ * The resources a headless run may use
+ */
+struct RunLimits {
+    /** The maximum number of steps */
+    std::uint64_t steps;
+
+    /** The maximum number of tape cells */
+    std::size_t cells;
+
+    RunLimits();
+};
+
+/** @struct RunResult
+ * The result of a headless run
+ */
+struct RunResult {
+    Outcome outcome;
+    std::uint64_t steps;
+
+    /** The label of the state the machine stopped on */
+    std::string state;
+
+    /** The final contents of the tape; @see FlatTape::contents() */
+    std::string tape;
+
+    /** Prints the result in a human-readable form */
+    void print(std::ostream& os) const;
+
+    /** Prints the outcome, steps, state and tape separated by spaces on a
+     * single line
+     */
+    void printLine(std::ostream& os) const;
+};
+
+/** @struct TierSteps
+ * The number of steps each tier of a runTiered() run executed
+ */
+struct TierSteps {
+    /** Steps interpreted on the register */
+    std::uint64_t interpreted;
+
+    /** Steps executed by the compiled engine without sweeps */
+    std::uint64_t compiled;
+
+    /** Steps executed by the compiled engine with sweeps */
+    std::uint64_t swept;
+
+    TierSteps();
+
+    /** Prints the steps of each tier on a single line */
+    void print(std::ostream& os) const;
+};
+
+/** Parses and resolves the machine in the given files, optionally
+ * optimizing it
+ * @param report Set to what the optimizer removed, unless nullptr
+ * @return True on failure (with diagnostics in err), false on success
+ */
+bool parseFiles(int num, const char* filenames[], bool optimize,
+                StateRegister& reg, OptimizerReport* report = nullptr);
+
+/** Compiles the machine in the given files, optionally optimizing it
+ * @param report Set to what the optimizer removed, unless nullptr
+ * @return True on failure (with diagnostics in err), false on success
+ */
+bool compileFiles(int num, const char* filenames[], bool optimize,
+                  Program& program, OptimizerReport* report = nullptr);
+
+/** Compiles the machine in the given source text, optionally optimizing it
+ * @param report Set to what the optimizer removed, unless nullptr
+ * @return True on failure (with diagnostics in err), false on success
+ */
+bool compileSource(const std::string& source, const char* name,
+                   bool optimize, Program& program,
+                   OptimizerReport* report = nullptr);
+
+/** Returns the result of an execution that stopped with the given
+ * outcome
+ */
+RunResult summarize(const Execution& exec, Outcome outcome);
+
+/** Runs program on the given input without any user interface */
+RunResult runProgram(const Program& program, const std::string& input,
+                     const RunLimits& limits);
+
+/** Runs the resolved states of reg on the given input like runProgram(),
+ * without compiling them for short runs: the run starts on the register,
+ * which interprets the rules as written, and moves with its tape and state
+ * to a compiled Program once it has taken TIER_UP_STEPS steps per state,
+ * or TIER_SAMPLE steps if that is more. The compiled program sweeps only
+ * if the loops the interpreter saw took TIER_SWEEP_LOOP steps or more on
+ * average
+ * @param tiers Set to the steps each tier executed
+ */
+RunResult runTiered(StateRegister& reg, const std::string& input,
+                    const RunLimits& limits, TierSteps& tiers);
+
+/** Runs program like runProgram(), measuring the run with hardware
+ * performance counters (@see PerfCounters) and printing the counts per
+ * step to os
+ * @param batch If nonzero, the run is split into batches of this many steps
+ * and each batch is reported on its own line as well
+ */
+RunResult profileProgram(const Program& program, const std::string& input,
+                         const RunLimits& limits, std::uint64_t batch,
+                         std::ostream& os);
+
+/** Runs program like runProgram(), adding a row to diagram every
+ * diagram.interval() steps, starting with the input
+ */
+RunResult drawProgram(const Program& program, const std::string& input,
+                      const RunLimits& limits, SpaceTimeDiagram& diagram);
+
+#endif /* RUNNER_HPP */
@@ -0,0 +1,163 @@
+#include <algorithm>
+#include <chrono>
+#include "Parallel.hpp"
+#include "Scheduler.hpp"
+
+/** The pass a task of priority one advances by per quantum */
+constexpr std::uint64_t STRIDE = 1 << 20;
+
+Scheduler::Task::Task(std::shared_ptr<const Program> program,
+                      const std::string& input, const RunLimits& limits,
+                      unsigned priority) :
+    program(program), exec(*program, limits.cells), maxSteps(limits.steps),
+    priority(std::min<std::uint64_t>(std::max(priority, 1u), STRIDE)),
+    pass(0), state(TaskState::Queued), steps(0), cancelling(false)
+{
+    exec.reset(input.c_str());
+}
+
+Scheduler::Scheduler(unsigned threads, std::uint64_t quantum) :
+    quantum_(std::max<std::uint64_t>(quantum, 1)), nextId_(1), now_(0),
+    stopping_(false)
+{
+    if (!threads)
+        threads = defaultThreads();
+    for (unsigned i = 0; i < threads; ++i)
+        threads_.emplace_back(&Scheduler::work, this);
+}
+
+Scheduler::~Scheduler()
+{
+    cancelAll();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    ready_.notify_all();
+    for (std::thread& thread : threads_)
+        thread.join();
+}
+
+Scheduler::TaskId Scheduler::submit(std::shared_ptr<const Program> program,
+                                    const std::string& input,
+                                    const RunLimits& limits,
+                                    unsigned priority)
+{
+    std::unique_ptr<Task> task(new Task(program, input, limits, priority));
+    std::lock_guard<std::mutex> lock(mutex_);
+    TaskId id = nextId_++;
+    task->pass = now_;
+    queue_.emplace(task->pass, id);
+    tasks_.emplace(id, std::move(task));
+    ready_.notify_one();
+    return id;
+}
+
+bool Scheduler::cancel(TaskId id)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = tasks_.find(id);
+    if (it == tasks_.end())
+        return true;
+    Task& task = *it->second;
+    if (task.state == TaskState::Queued) {
+        queue_.erase(std::make_pair(task.pass, id));
+        finish(task, TaskState::Cancelled, Outcome::StepLimit);
+    } else if (task.state == TaskState::Running)
+        task.cancelling = true;
+    else
+        return true;
+    return false;
+}
+
+void Scheduler::cancelAll()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& entry : tasks_) {
+        Task& task = *entry.second;
+        if (task.state == TaskState::Queued)
+            finish(task, TaskState::Cancelled, Outcome::StepLimit);
+        else if (task.state == TaskState::Running)
+            task.cancelling = true;
+    }
+    queue_.clear();
+}
+
+TaskProgress Scheduler::progress(TaskId id) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = tasks_.find(id);
+    if (it == tasks_.end())
+        return {TaskState::Unknown, 0};
+    return {it->second->state, it->second->steps};
+}
+
+TaskState Scheduler::wait(TaskId id, RunResult& result, int timeout)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto it = tasks_.find(id);
+    if (it == tasks_.end())
+        return TaskState::Unknown;
+    Task& task = *it->second;
+    auto stopped = [&task]() {
+        return task.state == TaskState::Finished ||
+               task.state == TaskState::Cancelled;
+    };
+    if (timeout < 0)
+        done_.wait(lock, stopped);
+    else if (!done_.wait_for(lock, std::chrono::milliseconds(timeout),
+                             stopped))
+    {
+        return task.state;
+    }
+    TaskState state = task.state;
+    result = std::move(task.result);
+    tasks_.erase(it);
+    return state;
+}
+
+void Scheduler::finish(Task& task, TaskState state, Outcome outcome)
+{
+    task.state = state;
+    task.steps = task.exec.steps();
+    task.result = summarize(task.exec, outcome);
+    done_.notify_all();
+}
+
+void Scheduler::work()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    do {
+        ready_.wait(lock, [this]() {
+            return stopping_ || !queue_.empty();
+        });
+        if (stopping_)
+            return;
+        TaskId id = queue_.begin()->second;
+        now_ = queue_.begin()->first;
+        queue_.erase(queue_.begin());
+        Task& task = *tasks_[id];
+        task.state = TaskState::Running;
+
+        // Only this thread touches a running task's execution, and the task
+        // is not erased while it is running
+        lock.unlock();
+        std::uint64_t steps = std::min(quantum_,
+                                       task.maxSteps - task.exec.steps());
+        Outcome outcome = task.exec.run(steps);
+        lock.lock();
+
+        if (outcome != Outcome::StepLimit ||
+            task.exec.steps() >= task.maxSteps)
+        {
+            finish(task, TaskState::Finished, outcome);
+        } else if (task.cancelling)
+            finish(task, TaskState::Cancelled, outcome);
+        else {
+            task.state = TaskState::Queued;
+            task.steps = task.exec.steps();
+            task.pass += STRIDE / task.priority;
+            queue_.emplace(task.pass, id);
+        }
+    } while (true);
+}
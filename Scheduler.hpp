@@ -0,0 +1,181 @@
+#ifndef SCHEDULER_HPP
+#define SCHEDULER_HPP
+
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "Runner.hpp"
+
+/** The number of steps a task runs before it yields its thread to the next
+ * task, unless a Scheduler is given another quantum
+ */
+#ifdef SCHEDULER_QUANTUM_STEPS
+constexpr std::uint64_t DEFAULT_QUANTUM = SCHEDULER_QUANTUM_STEPS;
+#else
+constexpr std::uint64_t DEFAULT_QUANTUM = 1 << 20;
+#endif /* SCHEDULER_QUANTUM_STEPS */
+
+/** Where a task of a Scheduler is in its life */
+enum class TaskState {
+    /** Waiting for a thread */
+    Queued,
+    /** Running a quantum on a thread */
+    Running,
+    /** Stopped with an outcome; the result is final */
+    Finished,
+    /** Stopped by Scheduler::cancel() before it finished */
+    Cancelled,
+    /** Never submitted, or forgotten after Scheduler::wait() */
+    Unknown,
+};
+
+/** @struct TaskProgress
+ * A snapshot of a task, @see Scheduler::progress()
+ */
+struct TaskProgress {
+    TaskState state;
+
+    /** The number of steps executed so far */
+    std::uint64_t steps;
+};
+
+/** @class Scheduler
+ * Interleaves many runs on a fixed set of threads. Each run is a resumable
+ * task (an Execution) which is executed a quantum of steps at a time, so a
+ * short run submitted behind long ones only waits for the quanta before it
+ * instead of for the long runs to finish. Threads pick the queued task with
+ * the lowest pass, which advances by a stride inversely proportional to the
+ * task's priority after every quantum: tasks of equal priority take turns,
+ * and a task of priority p gets p quanta for every quantum of a task of
+ * priority one, without starving it
+ */
+class Scheduler {
+public:
+    typedef std::uint64_t TaskId;
+
+private:
+    struct Task {
+        /** Keeps the program alive for exec */
+        std::shared_ptr<const Program> program;
+
+        Execution exec;
+        std::uint64_t maxSteps;
+        unsigned priority;
+
+        /** The virtual time at which the task is due for its next
+         * quantum
+         */
+        std::uint64_t pass;
+
+        TaskState state;
+
+        /** The number of steps as of the last quantum, since exec may be
+         * running
+         */
+        std::uint64_t steps;
+
+        /** Whether the task should be cancelled after its current
+         * quantum
+         */
+        bool cancelling;
+
+        RunResult result;
+
+        Task(std::shared_ptr<const Program> program,
+             const std::string& input, const RunLimits& limits,
+             unsigned priority);
+    };
+
+    std::uint64_t quantum_;
+
+    mutable std::mutex mutex_;
+
+    /** Signalled when a task is queued or the scheduler stops */
+    std::condition_variable ready_;
+
+    /** Signalled when a task finishes or is cancelled */
+    std::condition_variable done_;
+
+    std::unordered_map<TaskId, std::unique_ptr<Task>> tasks_;
+
+    /** The queued tasks ordered by (pass, id) */
+    std::set<std::pair<std::uint64_t, TaskId>> queue_;
+
+    TaskId nextId_;
+
+    /** The pass of the task that was last picked, which new tasks start
+     * at so that they do not get to catch up on the time before they were
+     * submitted
+     */
+    std::uint64_t now_;
+
+    bool stopping_;
+
+    std::vector<std::thread> threads_;
+
+    /** Runs quanta of queued tasks until stopping */
+    void work();
+
+    /** Records the result of a task that stopped and wakes its waiters
+     * @note Must be called with mutex_ held
+     */
+    void finish(Task& task, TaskState state, Outcome outcome);
+
+public:
+    /** Starts the given number of threads (@see defaultThreads() if zero)
+     * @param quantum The number of steps a task runs at a time
+     */
+    explicit Scheduler(unsigned threads = 0,
+                       std::uint64_t quantum = DEFAULT_QUANTUM);
+
+    /** Cancels every task and stops the threads. No thread may be waiting
+     * for a task anymore
+     */
+    ~Scheduler();
+
+    Scheduler(const Scheduler&) = delete;
+    Scheduler& operator=(const Scheduler&) = delete;
+
+    /** Queues a run of program on the given input
+     * @param priority The relative share of quanta the task gets (at least
+     * one)
+     * @return The id of the task, which stays valid until wait() returns
+     * its result
+     */
+    TaskId submit(std::shared_ptr<const Program> program,
+                  const std::string& input, const RunLimits& limits,
+                  unsigned priority = 1);
+
+    /** Cancels a task. A running task stops at the end of its quantum
+     * @return True if the task had already stopped or is unknown, false
+     * otherwise
+     */
+    bool cancel(TaskId id);
+
+    /** Cancels every task */
+    void cancelAll();
+
+    /** Returns the state of a task and the number of steps it has executed,
+     * as of its last quantum
+     */
+    TaskProgress progress(TaskId id) const;
+
+    /** Waits until a task has stopped and forgets it
+     * @param result Set to the result of the task. A cancelled task has the
+     * step-limit outcome and the configuration it was cancelled in
+     * @param timeout The longest time to wait in milliseconds, or negative
+     * to wait until the task stops
+     * @return The state of the task: Finished or Cancelled if it stopped
+     * (with result set), Queued or Running if the wait timed out, or
+     * Unknown
+     */
+    TaskState wait(TaskId id, RunResult& result, int timeout = -1);
+};
+
+#endif /* SCHEDULER_HPP */
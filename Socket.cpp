@@ -0,0 +1,114 @@
+#include <cerrno>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "Socket.hpp"
+
+SocketStream::SocketStream(int fd) : fd_(fd) {}
+
+SocketStream::~SocketStream()
+{
+    close(fd_);
+}
+
+bool SocketStream::fill()
+{
+    char data[4096];
+    ssize_t n;
+    do {
+        n = ::read(fd_, data, sizeof(data));
+    } while (n < 0 && errno == EINTR);
+    if (n <= 0)
+        return true;
+    buffer_.append(data, n);
+    return false;
+}
+
+bool SocketStream::readLine(std::string& line)
+{
+    std::size_t end;
+    while ((end = buffer_.find('\n')) == std::string::npos) {
+        if (fill())
+            return true;
+    }
+    line.assign(buffer_, 0, end);
+    buffer_.erase(0, end + 1);
+    return false;
+}
+
+bool SocketStream::read(std::size_t n, std::string& data)
+{
+    while (buffer_.size() < n) {
+        if (fill())
+            return true;
+    }
+    data.assign(buffer_, 0, n);
+    buffer_.erase(0, n);
+    return false;
+}
+
+bool SocketStream::write(const std::string& data)
+{
+    std::size_t done = 0;
+    while (done < data.size()) {
+        ssize_t n = ::send(fd_, data.data() + done, data.size() - done,
+                           MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return true;
+        done += n;
+    }
+    return false;
+}
+
+/** Fills in the address of the socket at path
+ * @return True if the path is too long, false otherwise
+ */
+static bool makeAddress(const char* path, sockaddr_un& addr)
+{
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (std::strlen(path) >= sizeof(addr.sun_path)) {
+        errno = ENAMETOOLONG;
+        return true;
+    }
+    std::strcpy(addr.sun_path, path);
+    return false;
+}
+
+int connectUnix(const char* path)
+{
+    sockaddr_un addr;
+    if (makeAddress(path, addr))
+        return -1;
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return -1;
+    if (connect(fd, (sockaddr*)&addr, sizeof(addr))) {
+        int error = errno;
+        close(fd);
+        errno = error;
+        return -1;
+    }
+    return fd;
+}
+
+int listenUnix(const char* path)
+{
+    sockaddr_un addr;
+    if (makeAddress(path, addr))
+        return -1;
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return -1;
+    unlink(path);
+    if (bind(fd, (sockaddr*)&addr, sizeof(addr)) || listen(fd, SOMAXCONN)) {
+        int error = errno;
+        close(fd);
+        errno = error;
+        return -1;
+    }
+    return fd;
+}
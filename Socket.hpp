@@ -0,0 +1,58 @@
+#ifndef SOCKET_HPP
+#define SOCKET_HPP
+
+#include <cstddef>
+#include <string>
+
+/** @class SocketStream
+ * Buffered reading and writing of lines and fixed-size payloads on a
+ * connected socket. The socket is closed on destruction
+ */
+class SocketStream {
+    int fd_;
+
+    /** Data that has been received but not consumed yet */
+    std::string buffer_;
+
+    /** Receives more data into buffer_
+     * @return True on end of file or error, false otherwise
+     */
+    bool fill();
+
+public:
+    explicit SocketStream(int fd);
+    ~SocketStream();
+
+    SocketStream(const SocketStream&) = delete;
+    SocketStream& operator=(const SocketStream&) = delete;
+
+    int fd() const { return fd_; }
+
+    /** Reads a line without its terminating newline
+     * @return True on end of file or error, false otherwise
+     */
+    bool readLine(std::string& line);
+
+    /** Reads exactly n bytes
+     * @return True on end of file or error, false otherwise
+     */
+    bool read(std::size_t n, std::string& data);
+
+    /** Writes all of data
+     * @return True on error, false otherwise
+     */
+    bool write(const std::string& data);
+};
+
+/** Connects to the Unix domain socket at the given path
+ * @return The socket, or -1 on error (with errno set)
+ */
+int connectUnix(const char* path);
+
+/** Creates a Unix domain socket listening at the given path, replacing any
+ * stale socket file
+ * @return The socket, or -1 on error (with errno set)
+ */
+int listenUnix(const char* path);
+
+#endif /* SOCKET_HPP */
@@ -0,0 +1,123 @@
+#include <algorithm>
+#include <fstream>
+#include <unordered_map>
+#include <utility>
+#include "StateLayout.hpp"
+#include "StateParser.hpp"
+
+std::vector<std::uint64_t> countTransitions(const Program& program,
+                                            const std::string& input,
+                                            const RunLimits& limits)
+{
+    Execution exec(program, limits.cells);
+    exec.reset(input.c_str());
+    TransitionCounter counter(program);
+    exec.run(limits.steps, counter);
+    return std::move(counter.counts);
+}
+
+std::vector<std::uint32_t> planLayout(const Program& program,
+                                      const std::vector<std::uint64_t>&
+                                          counts)
+{
+    std::uint32_t states = program.states(), columns = program.columns();
+    std::vector<std::uint64_t> heat(states, 0);
+    std::unordered_map<std::uint64_t, std::uint64_t> weights;
+    for (std::uint32_t s = 0; s < states; ++s) {
+        for (std::uint32_t c = 0; c < columns; ++c) {
+            std::uint64_t n = counts[s * columns + c];
+            std::uint32_t next = program.at(s, c).next;
+            heat[s] += n;
+            // Nothing may precede the initial state, which stays first
+            if (n && next != NO_STATE && next != s && next != 0)
+                weights[(std::uint64_t)s << 32 | next] += n;
+        }
+    }
+    std::vector<std::pair<std::uint64_t, std::uint64_t>> edges(
+        weights.begin(), weights.end());
+    std::sort(edges.begin(), edges.end(),
+              [](const std::pair<std::uint64_t, std::uint64_t>& a,
+                 const std::pair<std::uint64_t, std::uint64_t>& b) {
+                  return a.second != b.second ? a.second > b.second
+                                              : a.first < b.first;
+              });
+
+    // Join a chain ending in s to a different chain starting with t. first
+    // is only kept for the last state of each chain, and last for the first
+    std::vector<std::uint32_t> succ(states, NO_STATE), pred(states, NO_STATE);
+    std::vector<std::uint32_t> first(states), last(states);
+    for (std::uint32_t s = 0; s < states; ++s)
+        first[s] = last[s] = s;
+    for (const auto& edge : edges) {
+        std::uint32_t s = edge.first >> 32, t = (std::uint32_t)edge.first;
+        if (succ[s] != NO_STATE || pred[t] != NO_STATE || first[s] == t)
+            continue;
+        std::uint32_t head = first[s], tail = last[t];
+        succ[s] = t;
+        pred[t] = s;
+        last[head] = tail;
+        first[tail] = head;
+    }
+
+    std::vector<std::uint32_t> heads, order;
+    std::vector<std::uint64_t> chainHeat(states, 0);
+    for (std::uint32_t s = 0; s < states; ++s) {
+        if (pred[s] != NO_STATE)
+            continue;
+        for (std::uint32_t i = s; i != NO_STATE; i = succ[i])
+            chainHeat[s] += heat[i];
+        if (s)
+            heads.push_back(s);
+    }
+    std::stable_sort(heads.begin(), heads.end(),
+                     [&chainHeat](std::uint32_t a, std::uint32_t b) {
+                         return chainHeat[a] > chainHeat[b];
+                     });
+    if (states)
+        heads.insert(heads.begin(), 0);
+    order.reserve(states);
+    for (std::uint32_t head : heads) {
+        for (std::uint32_t i = head; i != NO_STATE; i = succ[i])
+            order.push_back(i);
+    }
+    return order;
+}
+
+void writeLayout(std::ostream& os, const Program& program,
+                 const std::vector<std::uint32_t>& order)
+{
+    for (std::uint32_t id : order)
+        os << program.label(id) << '\n';
+}
+
+bool readLayout(const char* path, const Program& program,
+                std::vector<std::uint32_t>& order)
+{
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        err << path << ": No such file" << std::endl;
+        return true;
+    }
+    std::unordered_map<std::string, std::uint32_t> ids;
+    for (std::uint32_t s = 0; s < program.states(); ++s)
+        ids.emplace(program.label(s), s);
+    std::vector<bool> placed(program.states(), false);
+    order.clear();
+    if (program.states()) {
+        order.push_back(0);
+        placed[0] = true;
+    }
+    std::string line;
+    while (std::getline(file, line)) {
+        auto it = ids.find(line);
+        if (it != ids.end() && !placed[it->second]) {
+            placed[it->second] = true;
+            order.push_back(it->second);
+        }
+    }
+    for (std::uint32_t s = 0; s < program.states(); ++s) {
+        if (!placed[s])
+            order.push_back(s);
+    }
+    return false;
+}
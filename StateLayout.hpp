@@ -0,0 +1,45 @@
+#ifndef STATE_LAYOUT_HPP
+#define STATE_LAYOUT_HPP
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "Runner.hpp"
+
+/** Runs program on the given input and counts how often each transition
+ * fires, indexed like the transition table (state * columns + column). The
+ * run does not sweep, so every step is counted
+ */
+std::vector<std::uint64_t> countTransitions(const Program& program,
+                                            const std::string& input,
+                                            const RunLimits& limits);
+
+/** Plans an order of the states (@see Program::renumber()) that keeps the
+ * states that follow each other most often next to each other, and the
+ * states that run most often together at the front of the table. The most
+ * frequent transitions between distinct states are taken greedily to join
+ * the states into chains, each state having at most one successor and one
+ * predecessor in its chain, and the chains are placed hottest first after
+ * the chain of the initial state, which stays first. States that never ran
+ * keep their order at the end
+ * @param counts The counts of the transitions (@see countTransitions())
+ */
+std::vector<std::uint32_t> planLayout(const Program& program,
+                                      const std::vector<std::uint64_t>&
+                                          counts);
+
+/** Writes the labels of the states in the given order, one per line */
+void writeLayout(std::ostream& os, const Program& program,
+                 const std::vector<std::uint32_t>& order);
+
+/** Reads a layout written by writeLayout() for the given program. Labels of
+ * states the program does not have are skipped, so a layout still applies
+ * after the program was edited, and states the layout does not list follow
+ * the ones it does in their current order
+ * @return True on failure (with diagnostics in err), false on success
+ */
+bool readLayout(const char* path, const Program& program,
+                std::vector<std::uint32_t>& order);
+
+#endif /* STATE_LAYOUT_HPP */
@@ -0,0 +1,171 @@
+#include <algorithm>
+#include <map>
+#include <unordered_map>
+#include <unordered_set>
+#include "StateOptimizer.hpp"
+
+OptimizerReport::OptimizerReport() : shadowed(0) {}
+
+bool OptimizerReport::empty() const
+{
+    return unreachable.empty() && merged.empty() && !shadowed;
+}
+
+void OptimizerReport::print(std::ostream& os) const
+{
+    for (const std::string& label : unreachable)
+        os << "Removed unreachable state `" << label << "'" << std::endl;
+    for (const auto& pair : merged) {
+        os << "Merged state `" << pair.first << "' into `" << pair.second
+           << "'" << std::endl;
+    }
+    if (shadowed)
+        os << "Removed " << shadowed << " shadowed rule"
+           << (shadowed == 1 ? "" : "s") << std::endl;
+}
+
+StateOptimizer::StateOptimizer(StateRegister& reg) : register_(reg) {}
+
+OptimizerReport StateOptimizer::optimize()
+{
+    OptimizerReport report;
+    removeShadowedRules(report);
+    removeUnreachable(report);
+    mergeEquivalent(report);
+    register_.reset();
+    register_.parser_.forgetSources();
+    register_.parser_.createRepr();
+    return report;
+}
+
+void StateOptimizer::removeShadowedRules(OptimizerReport& report)
+{
+    for (State& state : register_.states_) {
+        bool seen[256] = {false};
+        auto it = state.table.begin();
+        while (it != state.table.end()) {
+            unsigned char sym = it->sym;
+            if (seen[sym]) {
+                it = state.table.erase(it);
+                ++report.shadowed;
+            } else {
+                seen[sym] = true;
+                ++it;
+            }
+        }
+    }
+}
+
+void StateOptimizer::removeUnreachable(OptimizerReport& report)
+{
+    std::unordered_set<const State*> reached;
+    std::vector<const State*> stack;
+    reached.insert(&register_.states_.front());
+    stack.push_back(&register_.states_.front());
+    while (!stack.empty()) {
+        const State* state = stack.back();
+        stack.pop_back();
+        for (const Action& action : state->table) {
+            if (reached.insert(action.target).second)
+                stack.push_back(action.target);
+        }
+    }
+
+    auto it = register_.states_.begin();
+    while (it != register_.states_.end()) {
+        if (reached.count(&*it))
+            ++it;
+        else {
+            report.unreachable.push_back(it->label);
+            it = register_.states_.erase(it);
+        }
+    }
+}
+
+void StateOptimizer::mergeEquivalent(OptimizerReport& report)
+{
+    std::vector<State*> states;
+    std::unordered_map<const State*, int> index;
+    for (State& state : register_.states_) {
+        index[&state] = states.size();
+        states.push_back(&state);
+    }
+
+    // Initial partition: states with the same acceptance and the same
+    // (symbol, replacement, shift) triples are potentially equivalent
+    std::vector<int> block(states.size());
+    std::size_t blocks;
+    {
+        std::map<std::vector<int>, int> ids;
+        for (std::size_t i = 0; i < states.size(); ++i) {
+            std::vector<int> key{states[i]->final};
+            std::vector<int> rules;
+            for (const Action& action : states[i]->table) {
+                rules.push_back(((unsigned char)action.sym << 16) |
+                                ((unsigned char)action.replace << 8) |
+                                (unsigned char)action.shift);
+            }
+            std::sort(rules.begin(), rules.end());
+            key.insert(key.end(), rules.begin(), rules.end());
+            // The symbols a default action skips are part of its behavior
+            if (const Action* fallback = states[i]->fallback()) {
+                std::string except = fallback->except;
+                std::sort(except.begin(), except.end());
+                key.push_back(-1);
+                key.insert(key.end(), except.begin(), except.end());
+            }
+            block[i] = ids.emplace(key, ids.size()).first->second;
+        }
+        blocks = ids.size();
+    }
+
+    // Refine until the partition is stable: two states stay together only if
+    // every symbol leads them into the same block
+    do {
+        std::map<std::vector<int>, int> ids;
+        std::vector<int> refined(states.size());
+        for (std::size_t i = 0; i < states.size(); ++i) {
+            std::vector<std::pair<int, int>> edges;
+            for (const Action& action : states[i]->table) {
+                edges.emplace_back((unsigned char)action.sym,
+                                   block[index[action.target]]);
+            }
+            std::sort(edges.begin(), edges.end());
+            std::vector<int> key{block[i]};
+            for (const auto& edge : edges) {
+                key.push_back(edge.first);
+                key.push_back(edge.second);
+            }
+            refined[i] = ids.emplace(key, ids.size()).first->second;
+        }
+        block.swap(refined);
+        if (ids.size() == blocks)
+            break;
+        blocks = ids.size();
+    } while (true);
+
+    // The first state of each block (so always the initial state for its
+    // block) is kept as the representative
+    std::vector<State*> representative(blocks, nullptr);
+    for (std::size_t i = 0; i < states.size(); ++i) {
+        if (!representative[block[i]])
+            representative[block[i]] = states[i];
+    }
+    if (blocks == states.size())
+        return;
+
+    for (State* state : states) {
+        for (Action& action : state->table)
+            action.target = representative[block[index[action.target]]];
+    }
+    auto it = register_.states_.begin();
+    for (std::size_t i = 0; i < states.size(); ++i) {
+        State* kept = representative[block[i]];
+        if (kept == states[i])
+            ++it;
+        else {
+            report.merged.emplace_back(it->label, kept->label);
+            it = register_.states_.erase(it);
+        }
+    }
+}
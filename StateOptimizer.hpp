@@ -0,0 +1,71 @@
+#ifndef STATE_OPTIMIZER_HPP
+#define STATE_OPTIMIZER_HPP
+
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+#include "StateRegister.hpp"
+
+/** @struct OptimizerReport
+ * A summary of everything an optimization pass removed from a program
+ */
+struct OptimizerReport {
+    /** Labels of the states which could not be reached from the initial
+     * state
+     */
+    std::vector<std::string> unreachable;
+
+    /** Pairs of (removed, kept) labels for each state which was merged into
+     * an equivalent state
+     */
+    std::vector<std::pair<std::string, std::string>> merged;
+
+    /** The number of rules which could never fire because an earlier rule
+     * in the same state reads the same symbol
+     */
+    std::size_t shadowed;
+
+    OptimizerReport();
+
+    /** Returns whether the pass changed anything */
+    bool empty() const;
+
+    /** Prints the report in a human-readable form, one change per line */
+    void print(std::ostream& os) const;
+};
+
+/** @class StateOptimizer
+ * Simplifies a resolved program without changing its observable behavior:
+ * shadowed rules are dropped, states unreachable from the initial state are
+ * removed and behaviorally equivalent states are merged by partition
+ * refinement
+ */
+class StateOptimizer {
+    /** The register to optimize */
+    StateRegister& register_;
+
+    /** Removes every rule that follows another rule for the same symbol in
+     * the same state, since only the first match is ever used
+     */
+    void removeShadowedRules(OptimizerReport& report);
+
+    /** Removes all states which cannot be reached from the initial state */
+    void removeUnreachable(OptimizerReport& report);
+
+    /** Merges states which are indistinguishable by any input, keeping the
+     * first state of each equivalence class in register order
+     */
+    void mergeEquivalent(OptimizerReport& report);
+
+public:
+    StateOptimizer(StateRegister& reg);
+
+    /** Runs all of the passes and rebuilds the register's transcript
+     * @note Behavior is undefined if the register has not been successfully
+     * resolved
+     */
+    OptimizerReport optimize();
+};
+
+#endif /* STATE_OPTIMIZER_HPP */
@@ -1,5 +1,14 @@
+#include <algorithm>
 #include <iostream>
+#include <iterator>
+#include <list>
+#include <memory>
 #include <sstream>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "Parallel.hpp"
+#include "Program.hpp"
 #include "StateParser.hpp"
 
 constexpr const char* WHITESPACE = " \t";
@@ -17,47 +26,176 @@ inline bool isAlNum(char c)
            (c >= 'a' && c <= 'z') || c == '_';
 }
 
-ActionDef::ActionDef(const char *file, int line, char sym,
-                                 char replace, char shift, std::string target) :
-    file(file), line(line), sym(sym), replace(replace), shift(shift),
-    target(target) {}
+ActionDef::ActionDef(const char *file, int line, std::string syms,
+                     bool negated, char replace, char shift,
+                     std::string target) :
+    file(file), line(line), syms(syms), negated(negated), replace(replace),
+    shift(shift), target(target) {}
 
-StateParser::StateParser(StateRegister& reg) : register_(reg), 
-    parsingFile_(nullptr), parsingState_(nullptr) {}
+/** @struct ParseUnit
+ * The partial symbol table built from a single file. Units are parsed
+ * independently of each other and of the register, so they may be filled
+ * concurrently
+ */
+struct ParseUnit {
+    /** The name of the file being parsed */
+    const char* file;
+
+    /** The states defined in the file, in order of definition */
+    std::list<State> states;
+
+    /** The line on which each state in states was defined */
+    std::vector<int> lines;
+
+    /** The length of err when each state in states was defined, so that
+     * the diagnostics of merging the state can be put in line order
+     */
+    std::vector<std::size_t> offsets;
+
+    /** The labels in states, for detecting redefinitions within the file */
+    std::unordered_set<std::string> labels;
+
+    /** The initial state defined in this file, if any */
+    State* initial;
+
+    /** The state that was last parsed */
+    State* parsingState;
+
+    /** Diagnostics produced while parsing this file */
+    std::stringstream err;
+
+    /** The line number of the first line of the text being parsed */
+    int firstLine;
+
+    ParseUnit() :
+        file(nullptr), initial(nullptr), parsingState(nullptr), firstLine(1)
+    {}
+};
+
+/** @struct Block
+ * The text of one state of a file, from its label up to the next label
+ */
+struct Block {
+    std::string label;
+    std::string text;
+
+    /** The line number of the label */
+    int line;
+};
+
+/** Splits text into the text before the first label and a block per label,
+ * telling labels from rules the same way as parse()
+ */
+static void splitBlocks(const std::string& text, std::string& header,
+                        std::vector<Block>& blocks)
+{
+    std::string* current = &header;
+    std::size_t begin = 0, end;
+    int n = 0;
+    // Like parse(), drop a last line that has no newline
+    while ((end = text.find('\n', begin)) != std::string::npos) {
+        ++n;
+        std::size_t first = text.find_first_not_of(WHITESPACE, begin);
+        std::size_t colon = text.find(':', begin);
+        if (first < end && colon < end) {
+            blocks.push_back({text.substr(first, colon - first), "", n});
+            current = &blocks.back().text;
+        }
+        current->append(text, begin, end + 1 - begin);
+        begin = end + 1;
+    }
+}
+
+StateParser::StateParser(StateRegister& reg) : register_(reg) {}
 
 bool StateParser::addStates(const char *filename)
 {
-    bool ret = false;
-    std::ifstream file(filename);
-    repr_.clear();
-    parsingFile_ = filename;
-    if (!file.is_open())
-        err << filename << ": No such file" << std::endl;
-    else
-        ret |= parse(file);
-    return ret | resolveSymbols();
+    return addStates(1, &filename);
 }
 
 bool StateParser::addStates(int num, const char *filenames[])
 {
-    bool ret = false;
-    repr_.clear();
-    for (int i = 0; i < num; ++i) {
+    std::vector<char> failed(num, false);
+    std::unique_ptr<ParseUnit[]> units(new ParseUnit[num]);
+    std::vector<SourceFile> sources(num);
+    clearRepr();
+    parallelFor(num, [&](std::size_t i) {
         std::ifstream file(filenames[i]);
-        parsingFile_ = filenames[i];
-        if (!file.is_open())
-            err << filenames[i] << ": No such file" << std::endl;
-        else
-            ret |= parse(file);
+        units[i].file = filenames[i];
+        if (!file.is_open()) {
+            units[i].err << filenames[i] << ": No such file" << std::endl;
+            failed[i] = true;
+            return;
+        }
+        std::string text((std::istreambuf_iterator<char>(file)),
+                         std::istreambuf_iterator<char>());
+        std::istringstream stream(text);
+        failed[i] = parse(stream, units[i]);
+
+        std::vector<Block> blocks;
+        sources[i].name = filenames[i];
+        splitBlocks(text, sources[i].header, blocks);
+        for (Block& block : blocks)
+            sources[i].blocks[block.label].swap(block.text);
+    });
+    bool ret = false;
+    for (int i = 0; i < num; ++i)
+        ret |= failed[i];
+    ret |= merge(units.get(), num);
+    ret |= resolveSymbols();
+    if (!ret) {
+        for (SourceFile& source : sources)
+            sources_.push_back(std::move(source));
     }
+    return ret;
+}
+
+bool StateParser::addSource(const std::string& source, const char* name)
+{
+    ParseUnit unit;
+    std::istringstream stream(source);
+    unit.file = name;
+    clearRepr();
+    bool ret = parse(stream, unit);
+    ret |= merge(&unit, 1);
     return ret | resolveSymbols();
 }
 
-bool StateParser::parse(std::istream& stream)
+bool StateParser::addStates(const Program& program, const char* name)
+{
+    ParseUnit unit;
+    unit.file = name;
+    clearRepr();
+    for (std::uint32_t s = 0; s < program.states(); ++s) {
+        unit.states.emplace_back(program.label(s), program.final(s));
+        unit.lines.push_back(0);
+        unit.offsets.push_back(0);
+        State& state = unit.states.back();
+        if (!s)
+            unit.initial = &state;
+        // Rules are kept in reverse until they are resolved. The last
+        // column holds every symbol outside of the alphabet
+        for (std::uint32_t c = program.columns(); c-- > 0;) {
+            const Transition& t = program.at(s, c);
+            if (t.next == NO_STATE)
+                continue;
+            bool other = c + 1 == program.columns();
+            state.actionDefs.emplace_back(
+                name, 0, other ? program.alphabet()
+                               : std::string(1, program.alphabet()[c]),
+                other, t.keep ? ANY : Program::decode(t.write),
+                t.shift < 0 ? 'L' : t.shift > 0 ? 'R' : 'S',
+                program.label(t.next));
+        }
+    }
+    return merge(&unit, 1) | resolveSymbols();
+}
+
+bool StateParser::parse(std::istream& stream, ParseUnit& unit) const
 {
     std::string line, temp;
     bool ret = false;
-    int n = 0;
+    int n = unit.firstLine - 1;
     do {
         ++n;
         getline(stream, line);
@@ -66,21 +204,22 @@ bool StateParser::parse(std::istream& stream)
         line.erase(0, line.find_first_not_of(WHITESPACE));
         if (line.empty())
             continue;
-        int r = parseLabel(line, n);
+        int r = parseLabel(line, n, unit);
         ret |= r < 0;
         if (!r)
-            r = parseRule(line, n);
+            r = parseRule(line, n, unit);
         ret |= r < 0;
         if (!r) {
-            err << parsingFile_ << ':' << n
-                << ": Invalid syntax" << std::endl;
+            unit.err << unit.file << ':' << n
+                     << ": Invalid syntax" << std::endl;
             ret = true;
         }
     } while (true);
     return ret;
 }
 
-int StateParser::parseLabel(const std::string& line, int n)
+int StateParser::parseLabel(const std::string& line, int n,
+                            ParseUnit& unit) const
 {
     std::size_t i = line.find(':');
     if (i == std::string::npos)
@@ -91,19 +230,18 @@ int StateParser::parseLabel(const std::string& line, int n)
         char c = line[j];
         if (!isSpace(c)) {
             if (c == 'I') {
-                if (register_.currentState_ &&
-                    register_.currentState_->label != label)
-                {
-                    err << parsingFile_ << ':' << n
-                        << ": Redefinition of initial state" << std::endl;
+                if (unit.initial && unit.initial->label != label) {
+                    unit.err << unit.file << ':' << n
+                             << ": Redefinition of initial state"
+                             << std::endl;
                     return -1;
                 }
                 initial = true;
             } else if (c == 'F')
                 final = true;
             else {
-                err << parsingFile_ << ':' << n
-                    << ": Trailing characters after ':'" << std::endl;
+                unit.err << unit.file << ':' << n
+                         << ": Trailing characters after ':'" << std::endl;
                 return -1;
             }
         }
@@ -111,54 +249,83 @@ int StateParser::parseLabel(const std::string& line, int n)
     for (std::size_t j = 0; j < i; ++j) {
         char c = line[j];
         if (isSpace(c)) {
-            err << parsingFile_ << ':' << n
-                << ": Label contains a space" << std::endl;
+            unit.err << unit.file << ':' << n
+                     << ": Label contains a space" << std::endl;
             return -1;
         } else if (!isAlNum(c)) {
-            err << parsingFile_ << ':' << n
-                << ": Label is not alphanumeric" << std::endl;
+            unit.err << unit.file << ':' << n
+                     << ": Label is not alphanumeric" << std::endl;
             return -1;
         }
     }
-    for (State& state : register_.states_) {
-        if (state.label == label) {
-            err << parsingFile_ << ':' << n
-                << ": State with label `" << label
-                << "' has already been defined" << std::endl;
-            return -1;
-        }
-    }
-    if (initial) {
-        register_.states_.emplace_front(label, final);
-        parsingState_ = register_.currentState_ = &register_.states_.front();
-    } else {
-        register_.states_.emplace_back(label, final);
-        parsingState_ = &register_.states_.back();
+    if (!unit.labels.insert(label).second) {
+        unit.err << unit.file << ':' << n
+                 << ": State with label `" << label
+                 << "' has already been defined" << std::endl;
+        return -1;
     }
+    unit.states.emplace_back(label, final);
+    unit.lines.push_back(n);
+    unit.offsets.push_back(unit.err.tellp());
+    unit.parsingState = &unit.states.back();
+    if (initial)
+        unit.initial = unit.parsingState;
     return 1;
 }
 
-int StateParser::parseRule(const std::string& line, int n)
+int StateParser::parseRule(const std::string& line, int n,
+                           ParseUnit& unit) const
 {
-    if (!parsingState_) {
-        err << parsingFile_ << ':' << n
-            << ": Orphaned rule" << std::endl;
+    if (!unit.parsingState) {
+        unit.err << unit.file << ':' << n
+                 << ": Orphaned rule" << std::endl;
         return -1;
     }
 
-    char sym = line[0], replace, shift;
-    std::size_t i, j;
+    std::string syms(1, line[0]);
+    bool negated = false, named = true;
+    char replace, shift;
+    std::size_t i = 0, j;
+
+    // Match a symbol class, which has no spaces; a '[' on its own is a symbol
+    j = line.find(']', 2);
+    if (line[0] == '[' && j != std::string::npos &&
+        line.find_first_of(WHITESPACE) > j)
+    {
+        negated = line[1] == '^' && j > 2;
+        syms = line.substr(negated ? 2 : 1, j - (negated ? 2 : 1));
+        named = false;
+        i = j;
+    } else if (line[0] == ANY) {
+        syms.clear();
+        negated = true;
+        named = false;
+    }
+    if (syms.find(ANY) != std::string::npos) {
+        unit.err << unit.file << ':' << n
+                 << ": '" << ANY << "' can not be used in a symbol class"
+                 << std::endl;
+        return -1;
+    }
 
     // Match the replacement character
-    for (i = 1; i < line.size(); ++i) {
+    for (++i; i < line.size(); ++i) {
         if (!isSpace(line[i])) {
             replace = line[i];
             break;
         }
     }
     if (i >= line.size()) {
-        err << parsingFile_ << ':' << n
-            << ": Missing replacement character" << std::endl;
+        unit.err << unit.file << ':' << n
+                 << ": Missing replacement character" << std::endl;
+        return -1;
+    }
+    // '*' used to be an ordinary symbol, so catch rules written for it
+    if (replace == ANY && named) {
+        unit.err << unit.file << ':' << n
+                 << ": '" << ANY << "' writes back the symbol read and is"
+                 << " not a symbol; write `" << syms << "' instead"
+                 << std::endl;
         return -1;
     }
 
@@ -170,12 +337,12 @@ int StateParser::parseRule(const std::string& line, int n)
         }
     }
     if (i >= line.size()) {
-        err << parsingFile_ << ':' << n
-            << ": Missing shift" << std::endl;
+        unit.err << unit.file << ':' << n
+                 << ": Missing shift" << std::endl;
         return -1;
-    } else if (shift != 'L' && shift != 'R') {
-        err << parsingFile_ << ':' << n
-            << ": Direction must be 'L' or 'R'" << std::endl;
+    } else if (shift != 'L' && shift != 'R' && shift != 'S') {
+        unit.err << unit.file << ':' << n
+                 << ": Direction must be 'L', 'R' or 'S'" << std::endl;
         return -1;
     }
 
@@ -187,17 +354,17 @@ int StateParser::parseRule(const std::string& line, int n)
                 ++i;
                 break;
             } else {
-                err << parsingFile_ << ':' << n
-                    << ": Extraneous characters before '->'"
-                    << std::endl;
+                unit.err << unit.file << ':' << n
+                         << ": Extraneous characters before '->'"
+                         << std::endl;
                 return -1;
             }
         }
     }
     // Check for the '>' in '->'
     if (i >= line.size() || line[i] != '>') {
-        err << parsingFile_ << ':' << n << ": Missing '->'"
-            << std::endl;
+        unit.err << unit.file << ':' << n << ": Missing '->'"
+                 << std::endl;
         return -1;
     }
     // Find the beginning of the target label
@@ -206,8 +373,8 @@ int StateParser::parseRule(const std::string& line, int n)
             break;
     }
     if (i >= line.size()) {
-        err << parsingFile_ << ':' << n
-            << ": Missing target state" << std::endl;
+        unit.err << unit.file << ':' << n
+                 << ": Missing target state" << std::endl;
         return -1;
     }
     // Find the end of the target label
@@ -218,54 +385,312 @@ int StateParser::parseRule(const std::string& line, int n)
     // Check for trailing characters
     for (std::size_t k = j + 1; k < line.size(); ++k) {
         if (!isSpace(line[k])) {
-            err << parsingFile_ << ':' << n
-                << ": Trailing characters after target state"
-                      << std::endl;
+            unit.err << unit.file << ':' << n
+                     << ": Trailing characters after target state"
+                     << std::endl;
             return -1;
         }
     }
-    parsingState_->actionDefs.emplace_front(
-        parsingFile_, n, sym, replace, shift, line.substr(i, j - i));
+    // Rules are kept in reverse, so the previous rule is at the front
+    auto& defs = unit.parsingState->actionDefs;
+    if (!defs.empty() && defs.front().negated && defs.front().syms.empty()) {
+        unit.err << unit.file << ':' << n
+                 << ": Rule can never apply after a rule for '" << ANY
+                 << "', which reads every symbol" << std::endl;
+        return -1;
+    }
+    defs.emplace_front(unit.file, n, syms, negated, replace, shift,
+                       line.substr(i, j - i));
     return 1;
 }
 
+bool StateParser::merge(ParseUnit* units, std::size_t num)
+{
+    bool ret = false;
+    std::unordered_set<std::string> labels;
+    for (const State& state : register_.states_)
+        labels.insert(state.label);
+    for (std::size_t i = 0; i < num; ++i) {
+        ParseUnit& unit = units[i];
+        std::string text = unit.err.str();
+        std::size_t printed = 0;
+        auto line = unit.lines.begin();
+        auto offset = unit.offsets.begin();
+        auto it = unit.states.begin();
+        while (it != unit.states.end()) {
+            int n = *line++;
+            err.write(text.data() + printed, *offset - printed);
+            printed = *offset++;
+            if (&*it == unit.initial && register_.currentState_ &&
+                register_.currentState_->label != it->label)
+            {
+                err << unit.file << ':' << n
+                    << ": Redefinition of initial state" << std::endl;
+                ret = true;
+                it = unit.states.erase(it);
+            } else if (!labels.insert(it->label).second) {
+                err << unit.file << ':' << n
+                    << ": State with label `" << it->label
+                    << "' has already been defined" << std::endl;
+                ret = true;
+                it = unit.states.erase(it);
+            } else if (&*it == unit.initial) {
+                auto next = std::next(it);
+                register_.states_.splice(register_.states_.begin(),
+                                         unit.states, it);
+                register_.currentState_ = &register_.states_.front();
+                it = next;
+            } else
+                ++it;
+        }
+        err << text.substr(printed);
+        register_.states_.splice(register_.states_.end(), unit.states);
+    }
+    return ret;
+}
+
 bool StateParser::resolveSymbols()
 {
     bool ret = !register_.currentState_;
+    std::vector<State*> states;
+    index_.clear();
     for (State& state : register_.states_) {
-        for (ActionDef& def : state.actionDefs) {
-            bool found = false;
-            for (State& search : register_.states_) {
-                if (def.target == search.label) {
-                    found = true;
-                    state.table.emplace_front(def, search);
-                    break;
+        index_.emplace(state.label, &state);
+        states.push_back(&state);
+    }
+    ret |= resolve(states);
+
+    if (!register_.currentState_) {
+        err << ":: No initial state defined" << std::endl;
+        clearRepr();
+    } else
+        createRepr();
+    return ret;
+}
+
+bool StateParser::resolve(const std::vector<State*>& states)
+{
+    // Resolve fixed-size batches of states so that each batch's diagnostics
+    // can be reported in register order afterwards
+    constexpr std::size_t BATCH = 256;
+    std::size_t batches = (states.size() + BATCH - 1) / BATCH;
+    std::unique_ptr<std::stringstream[]> errs(new std::stringstream[batches]);
+    std::vector<char> failed(batches, false);
+    parallelFor(batches, [&](std::size_t b) {
+        std::size_t end = std::min(states.size(), (b + 1) * BATCH);
+        for (std::size_t i = b * BATCH; i < end; ++i) {
+            State& state = *states[i];
+            // The definitions are in reverse
+            for (auto def = state.actionDefs.rbegin();
+                 def != state.actionDefs.rend(); ++def)
+            {
+                auto search = index_.find(def->target);
+                if (search != index_.end())
+                    state.addRule(*def, *search->second);
+                else {
+                    errs[b] << def->file << ':' << def->line
+                            << ": Unrecognized label `" << def->target
+                            << "'" << std::endl;
+                    failed[b] = true;
                 }
             }
-            if (!found) {
-                err << def.file << ':' << def.line
-                          << ": Unrecognized label `" << def.target
-                          << "'" << std::endl;
+            state.actionDefs.clear();
+        }
+    });
+    bool ret = false;
+    for (std::size_t b = 0; b < batches; ++b) {
+        err << errs[b].str();
+        ret |= failed[b];
+    }
+    return ret;
+}
+
+void StateParser::forgetSources()
+{
+    sources_.clear();
+    index_.clear();
+}
+
+bool StateParser::reloadable() const
+{
+    return !sources_.empty();
+}
+
+bool StateParser::reload(const char* filename)
+{
+    auto source = std::find_if(sources_.begin(), sources_.end(),
+                               [filename](const SourceFile& source) {
+        return source.name == filename;
+    });
+    if (source == sources_.end()) {
+        err << filename << ": File was not loaded" << std::endl;
+        return true;
+    }
+    std::ifstream file(filename);
+    if (!file.is_open()) {
+        err << filename << ": No such file" << std::endl;
+        return true;
+    }
+    std::string text((std::istreambuf_iterator<char>(file)),
+                     std::istreambuf_iterator<char>());
+    SourceFile updated;
+    std::vector<Block> blocks;
+    splitBlocks(text, updated.header, blocks);
+
+    // Parse only the text that changed, checking the labels of the rest
+    ParseUnit unit;
+    unit.file = source->name.c_str();
+    bool ret = false;
+    if (updated.header != source->header) {
+        std::istringstream stream(updated.header);
+        ret |= parse(stream, unit);
+    }
+    for (const Block& block : blocks) {
+        auto old = source->blocks.find(block.label);
+        bool changed = old == source->blocks.end() ||
+                       old->second != block.text;
+        if (!updated.blocks.emplace(block.label, block.text).second) {
+            unit.err << unit.file << ':' << block.line
+                     << ": State with label `" << block.label
+                     << "' has already been defined" << std::endl;
+            ret = true;
+        } else if (old == source->blocks.end() && index_.count(block.label)) {
+            unit.err << unit.file << ':' << block.line
+                     << ": State with label `" << block.label
+                     << "' has already been defined in another file"
+                     << std::endl;
+            ret = true;
+        }
+        if (changed) {
+            std::istringstream stream(block.text);
+            unit.firstLine = block.line;
+            ret |= parse(stream, unit);
+        }
+    }
+    std::unordered_set<std::string> removed;
+    for (const auto& block : source->blocks) {
+        if (!updated.blocks.count(block.first))
+            removed.insert(block.first);
+    }
+    auto defined = [&](const std::string& label) {
+        return updated.blocks.count(label) ||
+               (index_.count(label) && !removed.count(label));
+    };
+    for (const State& state : unit.states) {
+        for (const ActionDef& def : state.actionDefs) {
+            if (!defined(def.target)) {
+                unit.err << def.file << ':' << def.line
+                         << ": Unrecognized label `" << def.target << "'"
+                         << std::endl;
                 ret = true;
             }
         }
-        state.actionDefs.clear();
     }
-    if (!register_.currentState_) {
-        err << ":: No initial state defined" << std::endl;
-        repr_.clear();
-    } else
-        createRepr();
+    if (!removed.empty()) {
+        std::unordered_set<std::string> parsed;
+        for (const State& state : unit.states)
+            parsed.insert(state.label);
+        for (const State& state : register_.states_) {
+            if (parsed.count(state.label) || removed.count(state.label))
+                continue;
+            for (const Action& action : state.table) {
+                if (removed.count(action.target->label)) {
+                    unit.err << unit.file << ": State `"
+                             << action.target->label << "' was removed but "
+                             << "is the target of a rule of `"
+                             << state.label << "'" << std::endl;
+                    ret = true;
+                }
+            }
+        }
+    }
+
+    // The initial state may only move within this file
+    std::string initial = register_.states_.front().label;
+    bool ownInitial = source->blocks.count(initial);
+    bool keptInitial = ownInitial && updated.blocks.count(initial) &&
+                       source->blocks[initial] == updated.blocks[initial];
+    if (unit.initial) {
+        if ((!ownInitial || keptInitial) && unit.initial->label != initial) {
+            unit.err << unit.file << ": Redefinition of initial state"
+                     << std::endl;
+            ret = true;
+        }
+        initial = unit.initial->label;
+    } else if (ownInitial && !keptInitial) {
+        unit.err << unit.file << ": No initial state defined" << std::endl;
+        ret = true;
+    }
+    err << unit.err.str();
+    if (ret)
+        return true;
+
+    // Replace the rules of changed states in place, so that the rules of
+    // other states that target them stay valid
+    std::vector<State*> changed;
+    for (auto it = unit.states.begin(); it != unit.states.end();) {
+        auto found = index_.find(it->label);
+        if (found != index_.end()) {
+            State& state = *found->second;
+            state.final = it->final;
+            state.table.clear();
+            state.actionDefs.swap(it->actionDefs);
+            changed.push_back(&state);
+            ++it;
+        } else {
+            auto next = std::next(it);
+            register_.states_.splice(register_.states_.end(), unit.states,
+                                     it);
+            State& state = register_.states_.back();
+            index_.emplace(state.label, &state);
+            changed.push_back(&state);
+            it = next;
+        }
+    }
+    if (!removed.empty()) {
+        for (auto it = register_.states_.begin();
+             it != register_.states_.end();)
+        {
+            if (!removed.count(it->label)) {
+                ++it;
+                continue;
+            }
+            if (&*it == register_.currentState_)
+                register_.currentState_ = nullptr;
+            index_.erase(it->label);
+            it = register_.states_.erase(it);
+        }
+    }
+    if (register_.states_.front().label != initial) {
+        auto it = std::find_if(register_.states_.begin(),
+                               register_.states_.end(),
+                               [&initial](const State& state) {
+            return state.label == initial;
+        });
+        register_.states_.splice(register_.states_.begin(),
+                                 register_.states_, it);
+    }
+    if (!register_.currentState_)
+        register_.reset();
+
+    ret = resolve(changed);
+    source->header.swap(updated.header);
+    source->blocks.swap(updated.blocks);
+    createRepr();
     return ret;
 }
 
 void StateParser::createRepr()
 {
     std::stringstream ss;
+    std::size_t line = 0;
     bool initial = true;
-    for (const State& state : register_.states_) {
-        if (!initial)
+    for (State& state : register_.states_) {
+        if (!initial) {
             ss << '\n';
+            ++line;
+        }
+        state.line = line++;
         ss << state.label << ':';
         if (initial) {
             ss << 'I';
@@ -274,15 +699,52 @@ void StateParser::createRepr()
         if (state.final)
             ss << 'F';
         ss << '\n';
-        for (const Action& action : state.table) {
-            ss << "    " << action.sym << ' ' << action.replace << ' '
-               << action.shift << " -> " << action.target.label << '\n';
+        for (Action& action : state.table) {
+            action.line = line++;
+            ss << "    ";
+            if (action.sym != ANY)
+                ss << action.sym;
+            else if (action.except.empty())
+                ss << ANY;
+            else
+                ss << "[^" << action.except << ']';
+            // A symbol written back is named, as the parser requires
+            char replace = action.replace == ANY && action.sym != ANY
+                               ? action.sym
+                               : action.replace;
+            ss << ' ' << replace << ' ' << action.shift << " -> "
+               << action.target->label << '\n';
         }
     }
     repr_ = ss.str();
+
+    lines_.clear();
+    lines_.reserve(line + 1);
+    lines_.push_back(0);
+    for (std::size_t i = 0; i < repr_.size(); ++i) {
+        if (repr_[i] == '\n')
+            lines_.push_back(i + 1);
+    }
+}
+
+void StateParser::clearRepr()
+{
+    repr_.clear();
+    lines_.clear();
 }
 
 std::string& StateParser::repr()
 {
     return repr_;
 }
+
+std::size_t StateParser::lines() const
+{
+    return lines_.empty() ? 0 : lines_.size() - 1;
+}
+
+const char* StateParser::line(std::size_t n, std::size_t& length) const
+{
+    length = lines_[n + 1] - lines_[n] - 1;
+    return repr_.data() + lines_[n];
+}
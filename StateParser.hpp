@@ -3,10 +3,20 @@
 
 #include <iostream>
 #include <fstream>
+#include <list>
 #include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 extern std::stringstream err;
 
+/** In the symbol of a rule, matches every symbol; in the replacement, writes
+ * back the symbol that was read. It is reserved, so rules can not read or
+ * write it by name
+ */
+constexpr char ANY = '*';
+
 /** @stuct ActionDef
  * Used to temporarily store parsed information before resolving state
  * labels
@@ -17,16 +27,22 @@ struct ActionDef {
 
     /** The line on which this action definition was found */
     int line;
-    char sym, replace, shift;
+
+    /** The symbols the rule reads, or does not read if negated is set */
+    std::string syms;
+    bool negated;
+    char replace, shift;
     std::string target;
 
-    ActionDef(const char *file, int line, char sym, char replace,
-             char shift, std::string target);
+    ActionDef(const char *file, int line, std::string syms, bool negated,
+              char replace, char shift, std::string target);
 };
 
+class Program;
 class StateRegister;
 struct Action;
 struct State;
+struct ParseUnit;
 
 class StateParser {
     /** The register to parse for */
@@ -34,56 +50,141 @@ class StateParser {
 
     /** A string representation of the register */
     std::string repr_;
-    
-    /** The name of the file currently being parsed */
-    const char* parsingFile_;
-    
-    /** The state that was last parsed */
-    State* parsingState_;
-
-    /** Parses the given istream
+
+    /** The offset in repr_ of the start of each line, followed by the
+     * offset of its end
+     */
+    std::vector<std::size_t> lines_;
+
+    /** @struct SourceFile
+     * A loaded file split into the text of each of its states, so that a
+     * reload only needs to parse the states whose text changed
+     */
+    struct SourceFile {
+        std::string name;
+
+        /** The text before the first label */
+        std::string header;
+
+        /** The text of each state, from its label up to the next label */
+        std::unordered_map<std::string, std::string> blocks;
+    };
+
+    /** The files the register was loaded from */
+    std::list<SourceFile> sources_;
+
+    /** Every state of the register by label */
+    std::unordered_map<std::string, State*> index_;
+
+    /** Parses the given istream into the partial symbol table of unit
      * @return True on failure, false on success
      */
-    bool parse(std::istream& stream);
+    bool parse(std::istream& stream, ParseUnit& unit) const;
 
     /** Attempts to parse the given line for a label and adds it to the list
-     * of states
+     * of states of unit
      * @return Zero if the line is not a label, negative on an error parsing
      * the label, or positive on success
      */
-    int parseLabel(const std::string& line, int n);
+    int parseLabel(const std::string& line, int n, ParseUnit& unit) const;
 
     /** Attempts to parse the given line for a rule and adds it to the list
-     * of rules for the state currently being parsed
+     * of rules for the state of unit currently being parsed. A rule reads a
+     * symbol, a class of symbols ("[abc]"), every symbol but a class
+     * ("[^abc]") or every symbol (ANY); it may write back the symbol read
+     * (ANY) and stay in place ('S') instead of shifting. ANY is not a
+     * symbol, so a rule for a single symbol may not write it, and no rule
+     * may follow one for ANY in the same state
      * @return Zero if the line is not a rule, negative on an error parsing
      * the rule, or positive on success
      */
-    int parseRule(const std::string& line, int n);
+    int parseRule(const std::string& line, int n, ParseUnit& unit) const;
+
+    /** Moves the states of each unit into the register in order, reporting
+     * labels defined by more than one unit and conflicting initial states.
+     * The diagnostics of each unit are reported along with these, in line
+     * order
+     * @return True on failure, false on success
+     */
+    bool merge(ParseUnit* units, std::size_t num);
 
     /** Resolves all of the action definitions (ActionDef) to actions (Action)
-     * by converting each parsed target label to a reference to a State
+     * by converting each parsed target label to a reference to a State. The
+     * states are resolved in parallel through a label index
      * @return True on failure, false on success
      */
     bool resolveSymbols();
 
+    /** Resolves the action definitions of the given states through index_
+     * @return True on failure, false on success
+     */
+    bool resolve(const std::vector<State*>& states);
+
+    /** Forgets the files the register was loaded from and the label index,
+     * e.g. because the optimizer changed the states so they no longer match
+     * the files
+     */
+    void forgetSources();
+
     /** Creates the string representation (@see repr_)
      * @note Called automatically by resolveSymbols
      */
     void createRepr();
 
+    /** Empties the string representation and its line index */
+    void clearRepr();
+
 public:
     StateParser(StateRegister& reg);
 
     std::string& repr();
 
+    /** Returns the number of lines in the string representation */
+    std::size_t lines() const;
+
+    /** Returns the nth line of the string representation, without its
+     * newline, in constant time
+     * @param length Set to the length of the line
+     */
+    const char* line(std::size_t n, std::size_t& length) const;
+
     /** Adds all of the rules for the given file and resolves them */
     bool addStates(const char* filename);
 
     /** Adds all of the rules in each of the num files named in filenames and
-     * resolves them
+     * resolves them. Each file is parsed on its own thread into a partial
+     * symbol table before the tables are merged in argument order
      * @note Inteded for use with argv
      */
     bool addStates(int num, const char* filenames[]);
+
+    /** Adds all of the rules in the given source text and resolves them
+     * @param name The name to use in place of a file name in diagnostics
+     */
+    bool addSource(const std::string& source, const char* name);
+
+    /** Adds all of the states and rules of a compiled program, e.g. one
+     * imported from compact notation, and resolves them
+     * @param name The name to use in place of a file name in diagnostics
+     */
+    bool addStates(const Program& program, const char* name);
+
+    /** Returns whether the states were loaded from files that can be
+     * reloaded
+     */
+    bool reloadable() const;
+
+    /** Re-reads a file that was loaded by addStates() and updates the states
+     * whose text changed in place. States that were added are appended,
+     * states that were removed are dropped, and only the rules of changed
+     * and added states are resolved again. If the current state was removed,
+     * the register returns to the initial state. Nothing changes if the
+     * file has an error
+     * @return True on failure, false on success
+     */
+    bool reload(const char* filename);
+
+    friend class StateOptimizer;
 };
 
 #include "StateRegister.hpp"
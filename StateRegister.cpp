@@ -1,12 +1,45 @@
+#include <iterator>
 #include "StateRegister.hpp"
 
 StateRegister::StateRegister() : parser_(*this), currentState_(nullptr) {}
 
-Action::Action(ActionDef& def, State& target) :
-    sym(def.sym), replace(def.replace), shift(def.shift), target(target) {}
+Action::Action(char sym, char replace, char shift, State& target) :
+    sym(sym), replace(replace), shift(shift), target(&target), line(0),
+    breakpoint(false) {}
 
 State::State(std::string label, bool final) :
-    label(label), final(final) {}
+    label(label), final(final), line(0) {}
+
+const Action* State::fallback() const
+{
+    return (!table.empty() && table.back().sym == ANY) ? &table.back()
+                                                       : nullptr;
+}
+
+void State::addRule(const ActionDef& def, State& target)
+{
+    const Action* fallback = this->fallback();
+    if (def.negated && !fallback) {
+        table.emplace_back(ANY, def.replace, def.shift, target);
+        table.back().except = def.syms;
+        return;
+    }
+    // Behind a default action, only the symbols it skips are left
+    std::string syms;
+    if (!fallback)
+        syms = def.syms;
+    else {
+        for (char sym : fallback->except) {
+            if ((def.syms.find(sym) == std::string::npos) == def.negated)
+                syms += sym;
+        }
+    }
+    auto end = fallback ? std::prev(table.end()) : table.end();
+    for (char sym : syms) {
+        table.emplace(end, sym, def.replace == ANY ? sym : def.replace,
+                      def.shift, target);
+    }
+}
 
 StateParser& StateRegister::parser()
 {
@@ -20,13 +53,68 @@ void StateRegister::reset()
 
 int StateRegister::handle(char sym)
 {
-    for (Action& action : currentState_->table) {
-        if (action.sym == sym) {
-            currentState_ = &action.target;
-            return (action.replace << 8) | action.shift;
+    const Action* action = find(sym);
+    if (!action)
+        return -1;
+    currentState_ = action->target;
+    char replace = action->replace == ANY ? sym : action->replace;
+    return ((unsigned char)replace << 8) | action->shift |
+           (action->breakpoint ? BREAKPOINT : 0);
+}
+
+const Action* StateRegister::find(char sym) const
+{
+    for (const Action& action : currentState_->table) {
+        if (action.matches(sym))
+            return &action;
+    }
+    return nullptr;
+}
+
+bool StateRegister::breakOnState(const std::string& label)
+{
+    bool found = false;
+    for (State& state : states_) {
+        found |= state.label == label;
+        for (Action& action : state.table) {
+            if (action.target->label == label)
+                action.breakpoint = true;
         }
     }
-    return -1;
+    return !found;
+}
+
+bool StateRegister::breakOnRule(const std::string& label, char sym)
+{
+    for (State& state : states_) {
+        if (state.label != label)
+            continue;
+        for (Action& action : state.table) {
+            if (action.matches(sym)) {
+                action.breakpoint = true;
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+void StateRegister::breakOnWrite(char sym)
+{
+    for (State& state : states_) {
+        for (Action& action : state.table) {
+            if (action.replace == sym)
+                action.breakpoint = true;
+        }
+    }
+}
+
+void StateRegister::clearBreakpoints()
+{
+    for (State& state : states_) {
+        for (Action& action : state.table)
+            action.breakpoint = false;
+    }
 }
 
 std::string& StateRegister::transcript()
@@ -39,6 +127,11 @@ const char *StateRegister::getState() const
     return currentState_->label.c_str();
 }
 
+std::size_t StateRegister::getLine() const
+{
+    return currentState_->line;
+}
+
 bool StateRegister::onFinal() const
 {
     return currentState_->final;
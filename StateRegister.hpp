@@ -7,26 +7,47 @@
 
 struct State;
 
+/** Set in the result of StateRegister::handle() when the action that was
+ * executed is a breakpoint
+ */
+constexpr int BREAKPOINT = 1 << 16;
+
 /** @struct Action
  * An action that changes the state of a finite state machine
  */
 struct Action {
-    /** The symbol which must be read for the action to execute */
+    /** The symbol which must be read for the action to execute, or ANY if
+     * every symbol not in except is
+     */
     char sym;
 
-    /** The symbol to replace the read symbol with */
+    /** The symbol to replace the read symbol with, or ANY to keep it */
     char replace;
 
     /** The direction to move the tape after changing the read symbol
-     * (either 'L' or 'R')
+     * ('L' or 'R', or 'S' to stay)
      */
     char shift;
 
     /** The state to move to when executing the action */
-    State& target;
+    State* target;
+
+    /** The line of the transcript this action is printed on */
+    std::size_t line;
+
+    /** Whether executing this action should stop TuringMachine::run() */
+    bool breakpoint;
+
+    /** The symbols an action for ANY does not read */
+    std::string except;
+
+    Action(char sym, char replace, char shift, State& target);
 
-    /** Constructs an action from a definition and a target state */
-    Action(ActionDef& def, State& target);
+    /** Returns whether this action reads the given symbol */
+    bool matches(char c) const
+    {
+        return sym == ANY ? except.find(c) == std::string::npos : sym == c;
+    }
 };
 
 /** @struct State
@@ -44,14 +65,29 @@ struct State {
      */
     std::list<ActionDef> actionDefs;
     
-    /** The table of actions for this state */
+    /** The table of actions for this state. Symbol classes are expanded to
+     * an action per symbol, except for the first rule that reads every
+     * symbol but a few, which becomes a single default action for ANY at
+     * the end of the table
+     */
     std::list<Action> table;
 
+    /** The line of the transcript this state's label is printed on */
+    std::size_t line;
+
     /** Constructs a state with an empty table
      * @param label The name for the state
      * @param final Whether this state should be an accepting state
      */
     State(std::string label, bool final);
+
+    /** Returns the default action, or nullptr if there is none */
+    const Action* fallback() const;
+
+    /** Adds the rule defined by def after the rules in the table, leaving
+     * out the symbols the default action already reads
+     */
+    void addRule(const ActionDef& def, State& target);
 };
 
 /** @class StateRegister
@@ -78,15 +114,45 @@ public:
     /** Restores the current state to the initial state */
     void reset();
 
+    /** Returns the number of states */
+    std::size_t states() const { return states_.size(); }
+
     /** Handles the given event symbol by advancing the state if there is a
      * match and returning the data that needs to be changed
      * @return If there is a match, an integer with the shift in the least
-     * significant byte and the replacement character in the adjacent byte.
-     * If there is no match, a negative integer
+     * significant byte, the replacement character in the adjacent byte and
+     * BREAKPOINT set if the action is a breakpoint. If there is no match, a
+     * negative integer
      * @note Behavior is undefined if an initial state has not been defined
      */
     int handle(char sym);
 
+    /** Returns the action of the current state that would handle the given
+     * symbol, or nullptr if there is none
+     */
+    const Action* find(char sym) const;
+
+    /** Marks every action that enters the state with the given label as a
+     * breakpoint
+     * @return True if there is no such state, false otherwise
+     */
+    bool breakOnState(const std::string& label);
+
+    /** Marks the action of the state with the given label that handles sym
+     * as a breakpoint. If that is the default action, it breaks on every
+     * symbol it reads
+     * @return True if there is no such action, false otherwise
+     */
+    bool breakOnRule(const std::string& label, char sym);
+
+    /** Marks every action that writes sym as a breakpoint. Default actions
+     * that keep the symbol they read are not marked
+     */
+    void breakOnWrite(char sym);
+
+    /** Unmarks every action */
+    void clearBreakpoints();
+
     /** Returns a string representation of this machine's states and rules in
      * the canonical format
      */
@@ -97,10 +163,17 @@ public:
      */
     const char* getState() const;
 
+    /** Returns the line of the transcript the current state's label is on
+     * @note Behavior is undefined if an initial state has not been defined
+     */
+    std::size_t getLine() const;
+
     /** Returns whether the current state is final (accepting) */
     bool onFinal() const;
 
     friend class StateParser;
+    friend class StateOptimizer;
+    friend class Program;
 };
 
 #endif /* STATE_MACHINE_HPP */
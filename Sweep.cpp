@@ -0,0 +1,193 @@
+#include "Sweep.hpp"
+#include "CpuFeatures.hpp"
+
+#ifdef __SSE2__
+#include <immintrin.h>
+#define SWEEP_X86
+#endif
+
+SweepSet::SweepSet() : count(0), negated(false), member{0, 0, 0, 0} {}
+
+void SweepSet::insert(std::uint8_t sym)
+{
+    if (contains(sym))
+        return;
+    if (count < MAX_SWEEP_SYMBOLS)
+        symbols[count] = sym;
+    ++count;
+    member[sym >> 6] |= (std::uint64_t)1 << (sym & 63);
+    if (count + MAX_SWEEP_SYMBOLS >= 256) {
+        unsigned k = 0;
+        for (unsigned c = 0; c < 256; ++c) {
+            if (!contains(c))
+                symbols[k++] = c;
+        }
+        negated = true;
+    }
+}
+
+/** Returns the number of symbols the vector scans compare against */
+static inline unsigned scanned(const SweepSet& set)
+{
+    return set.negated ? 256 - set.count : set.count;
+}
+
+static std::size_t scalarForward(const std::uint8_t* p, std::size_t n,
+                                 const SweepSet& set)
+{
+    std::size_t i = 0;
+    while (i < n && set.contains(p[i]))
+        ++i;
+    return i;
+}
+
+static std::size_t scalarBackward(const std::uint8_t* p, std::size_t n,
+                                  const SweepSet& set)
+{
+    std::size_t i = 0;
+    while (i < n && set.contains(*(p - i)))
+        ++i;
+    return i;
+}
+
+#ifdef SWEEP_X86
+
+/** Returns a mask of the bytes of v that equal one of the count symbols */
+static inline __m128i matchSse2(__m128i v, const __m128i* syms,
+                                unsigned count)
+{
+    __m128i m = _mm_cmpeq_epi8(v, syms[0]);
+    for (unsigned k = 1; k < count; ++k)
+        m = _mm_or_si128(m, _mm_cmpeq_epi8(v, syms[k]));
+    return m;
+}
+
+/** The vector scans compare against the symbols of the set, and stop on
+ * the first byte that matches none of them, or if Negated, against the
+ * symbols left out of the set, and stop on the first byte that matches one
+ */
+template <bool Negated>
+static std::size_t sse2Forward(const std::uint8_t* p, std::size_t n,
+                               const SweepSet& set)
+{
+    __m128i syms[MAX_SWEEP_SYMBOLS];
+    unsigned count = scanned(set);
+    for (unsigned k = 0; k < count; ++k)
+        syms[k] = _mm_set1_epi8(set.symbols[k]);
+    std::size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(p + i));
+        unsigned hits = _mm_movemask_epi8(matchSse2(v, syms, count));
+        unsigned miss = (Negated ? hits : ~hits) & 0xFFFF;
+        if (miss)
+            return i + __builtin_ctz(miss);
+    }
+    return i + scalarForward(p + i, n - i, set);
+}
+
+template <bool Negated>
+static std::size_t sse2Backward(const std::uint8_t* p, std::size_t n,
+                                const SweepSet& set)
+{
+    __m128i syms[MAX_SWEEP_SYMBOLS];
+    unsigned count = scanned(set);
+    for (unsigned k = 0; k < count; ++k)
+        syms[k] = _mm_set1_epi8(set.symbols[k]);
+    std::size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(p - i - 15));
+        unsigned hits = _mm_movemask_epi8(matchSse2(v, syms, count));
+        unsigned miss = (Negated ? hits : ~hits) & 0xFFFF;
+        if (miss)
+            return i + (__builtin_clz(miss) - 16);
+    }
+    return i + scalarBackward(p - i, n - i, set);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i matchAvx2(__m256i v, const __m256i* syms,
+                                unsigned count)
+{
+    __m256i m = _mm256_cmpeq_epi8(v, syms[0]);
+    for (unsigned k = 1; k < count; ++k)
+        m = _mm256_or_si256(m, _mm256_cmpeq_epi8(v, syms[k]));
+    return m;
+}
+
+template <bool Negated>
+__attribute__((target("avx2")))
+static std::size_t avx2Forward(const std::uint8_t* p, std::size_t n,
+                               const SweepSet& set)
+{
+    __m256i syms[MAX_SWEEP_SYMBOLS];
+    unsigned count = scanned(set);
+    for (unsigned k = 0; k < count; ++k)
+        syms[k] = _mm256_set1_epi8(set.symbols[k]);
+    std::size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(p + i));
+        unsigned hits = _mm256_movemask_epi8(matchAvx2(v, syms, count));
+        unsigned miss = Negated ? hits : ~hits;
+        if (miss)
+            return i + __builtin_ctz(miss);
+    }
+    return i + sse2Forward<Negated>(p + i, n - i, set);
+}
+
+template <bool Negated>
+__attribute__((target("avx2")))
+static std::size_t avx2Backward(const std::uint8_t* p, std::size_t n,
+                                const SweepSet& set)
+{
+    __m256i syms[MAX_SWEEP_SYMBOLS];
+    unsigned count = scanned(set);
+    for (unsigned k = 0; k < count; ++k)
+        syms[k] = _mm256_set1_epi8(set.symbols[k]);
+    std::size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(p - i - 31));
+        unsigned hits = _mm256_movemask_epi8(matchAvx2(v, syms, count));
+        unsigned miss = Negated ? hits : ~hits;
+        if (miss)
+            return i + __builtin_clz(miss);
+    }
+    return i + sse2Backward<Negated>(p - i, n - i, set);
+}
+
+#endif /* SWEEP_X86 */
+
+std::size_t spanForward(const std::uint8_t* p, std::size_t n,
+                        const SweepSet& set)
+{
+    if (set.count == 256)
+        return n;
+#ifdef SWEEP_X86
+    if (set.negated) {
+        return hasAvx2() ? avx2Forward<true>(p, n, set)
+                       : sse2Forward<true>(p, n, set);
+    }
+    if (set.count <= MAX_SWEEP_SYMBOLS) {
+        return hasAvx2() ? avx2Forward<false>(p, n, set)
+                       : sse2Forward<false>(p, n, set);
+    }
+#endif /* SWEEP_X86 */
+    return scalarForward(p, n, set);
+}
+
+std::size_t spanBackward(const std::uint8_t* p, std::size_t n,
+                         const SweepSet& set)
+{
+    if (set.count == 256)
+        return n;
+#ifdef SWEEP_X86
+    if (set.negated) {
+        return hasAvx2() ? avx2Backward<true>(p, n, set)
+                       : sse2Backward<true>(p, n, set);
+    }
+    if (set.count <= MAX_SWEEP_SYMBOLS) {
+        return hasAvx2() ? avx2Backward<false>(p, n, set)
+                       : sse2Backward<false>(p, n, set);
+    }
+#endif /* SWEEP_X86 */
+    return scalarBackward(p, n, set);
+}
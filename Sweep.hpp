@@ -0,0 +1,56 @@
+#ifndef SWEEP_HPP
+#define SWEEP_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+/** The number of symbols a sweep may loop on, or skip, and still be
+ * scanned with vector compares; other sets fall back to a scalar loop
+ */
+constexpr unsigned MAX_SWEEP_SYMBOLS = 8;
+
+/** @struct SweepSet
+ * The encoded symbols on which a state loops to itself, rewriting the
+ * symbol unchanged and moving in the same direction
+ */
+struct SweepSet {
+    /** The number of symbols in the set */
+    unsigned count;
+
+    /** The first MAX_SWEEP_SYMBOLS symbols in the set, or if negated is
+     * set, every symbol not in the set
+     */
+    std::uint8_t symbols[MAX_SWEEP_SYMBOLS];
+
+    /** Whether the set holds all but at most MAX_SWEEP_SYMBOLS symbols, as
+     * it does for a looping default action, so that scans look for the
+     * symbols left out instead
+     */
+    bool negated;
+
+    /** A bitmap of every symbol in the set */
+    std::uint64_t member[4];
+
+    SweepSet();
+
+    void insert(std::uint8_t sym);
+
+    bool contains(std::uint8_t sym) const
+    {
+        return (member[sym >> 6] >> (sym & 63)) & 1;
+    }
+};
+
+/** Returns the number of cells from p[0] up to p[n - 1] before the first
+ * cell not in the set (n if they are all in the set)
+ */
+std::size_t spanForward(const std::uint8_t* p, std::size_t n,
+                        const SweepSet& set);
+
+/** Returns the number of cells from p[0] down to p[1 - n] before the first
+ * cell not in the set (n if they are all in the set)
+ */
+std::size_t spanBackward(const std::uint8_t* p, std::size_t n,
+                         const SweepSet& set);
+
+#endif /* SWEEP_HPP */
@@ -1,127 +1,112 @@
 #include <curses.h>
+#include <new>
+#include <sys/mman.h>
+#include <unistd.h>
 #include "Tape.hpp"
 
-/** Although the tape should theoretically be infinite, we have to limit its
- * size in order to prevent an infinite loop from consuming all of the
- * system's memory
+/** The smallest mapping worth using when the system refuses to reserve
+ * TAPE_RESERVE
  */
-#ifdef MAX_TAPE_CELLS
-constexpr std::size_t MAX_CELLS = MAX_TAPE_CELLS;
-#else
-constexpr std::size_t MAX_CELLS = 1000000;
-#endif /* MAX_TAPE_CELLS */
+constexpr std::size_t MIN_RESERVE = 1 << 20;
 
-Tape::Cell::Cell(char sym, Cell *prev, Cell *next) :
-    sym(sym), prev(prev ? prev : this), next(next ? next : this) {}
+/** The size of a transparent huge page on x86-64 */
+constexpr std::size_t HUGE_PAGE = 1 << 21;
 
-Tape::Tape() : head_(new Cell(BLANK)), size_(1) {}
-
-Tape::~Tape()
+Tape::Tape(std::size_t budget) :
+    cells_(nullptr), reserved_(TAPE_RESERVE), budget_(budget),
+    page_(sysconf(_SC_PAGESIZE)), exhausted_(false)
 {
-    Cell *back = head_, *front = head_;
-    while (back->prev != back)
-        back = back->prev;
-    while (front->next != front)
-        front = front->next;
-    if (back == front)
-        delete front;
-    else {
-        Cell *cell = back->next;
-        while (cell != front) {
-            Cell *next = cell->next;
-            delete cell;
-            cell = next;
-        }
-        delete back;
-        delete front;
+    void* map = MAP_FAILED;
+    for (; reserved_ >= MIN_RESERVE; reserved_ /= 2) {
+        map = mmap(nullptr, reserved_, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (map != MAP_FAILED)
+            break;
     }
+    if (map == MAP_FAILED)
+        throw std::bad_alloc();
+    cells_ = (std::uint8_t*)map;
+#if defined(TAPE_HUGE_PAGES) && defined(MADV_HUGEPAGE)
+    if (!madvise(map, reserved_, MADV_HUGEPAGE))
+        page_ = HUGE_PAGE;
+#endif /* TAPE_HUGE_PAGES && MADV_HUGEPAGE */
+    head_ = left_ = right_ = reserved_ / 2;
 }
 
-bool Tape::duplicateLeft()
+Tape::~Tape()
 {
-    if (size_ >= MAX_CELLS)
-        return true;
-    ++size_;
-    head_->prev = new Cell(head_->sym, nullptr, head_);
-    return false;
+    munmap(cells_, reserved_);
 }
 
-bool Tape::duplicateRight()
+std::size_t Tape::span(std::size_t left, std::size_t right) const
 {
-    if (size_ >= MAX_CELLS)
-        return true;
-    ++size_;
-    head_->next = new Cell(head_->sym, head_, nullptr);
-    return false;
+    std::size_t begin = left / page_ * page_;
+    std::size_t end = (right / page_ + 1) * page_;
+    return end - begin;
 }
 
-bool Tape::moveLeft()
+bool Tape::extendLeft()
 {
-    if ((head_->prev == head_) && duplicateLeft())
+    // The index wraps around when the head passes the start of the mapping
+    if (head_ >= reserved_ || span(head_, right_) > budget_) {
+        ++head_;
+        exhausted_ = true;
         return true;
-    head_ = head_->prev;
+    }
+    left_ = head_;
     return false;
 }
 
-bool Tape::moveRight()
+bool Tape::extendRight()
 {
-    if ((head_->next == head_) && duplicateRight())
+    if (head_ >= reserved_ || span(left_, head_) > budget_) {
+        --head_;
+        exhausted_ = true;
         return true;
-    head_ = head_->next;
+    }
+    right_ = head_;
     return false;
 }
 
 void Tape::clear()
 {
-    Cell* cell = head_;
-    while (cell->prev != cell) {
-        cell->sym = BLANK;
-        cell = cell->prev;
-    }
-    while (head_->next != head_) {
-        head_->sym = BLANK;
-        head_ = head_->next;
-    }
-    for (std::size_t i = 0; i < size_ / 2; ++i) // Center the head
-        head_ = head_->prev;
-}
-
-bool Tape::writeHead(char sym)
-{
-    if (((head_->prev == head_) && duplicateLeft()) ||
-        ((head_->next == head_) && duplicateRight()))
-        return true;
-    head_->sym = sym;
-    return false;
+    std::size_t begin = left_ / page_ * page_;
+    // Private anonymous pages read as zero again once they are released
+    madvise(cells_ + begin, span(left_, right_), MADV_DONTNEED);
+    head_ = left_ = right_ = reserved_ / 2;
+    exhausted_ = false;
 }
 
-char Tape::readHead()
+void Tape::setBudget(std::size_t budget)
 {
-    return head_->sym;
+    budget_ = budget;
 }
 
-bool Tape::outOfMemory() const
+void Tape::setCellBudget(std::size_t cells)
 {
-    return size_ >= MAX_CELLS;
+    budget_ = ((cells + page_ - 1) / page_ + 1) * page_;
 }
 
-void Tape::printLeft(WINDOW* win, Cell *cell, int n)
+std::size_t Tape::committed() const
 {
-    if (n) {
-        printLeft(win, cell->prev, n - 1);
-        waddch(win, cell->prev->sym);
-    }
+    return span(left_, right_);
 }
 
-void Tape::printRight(WINDOW* win, Cell *cell, int n)
+bool Tape::outOfMemory() const
 {
-    for (int i = 0; i < n; ++i, cell = cell->next)
-        waddch(win, cell->next->sym);
+    return exhausted_;
 }
 
 void Tape::print(WINDOW* win, int width)
 {
-    printLeft(win, head_, width / 2);
-    waddch(win, head_->sym);
-    printRight(win, head_, (width - 1) / 2);
+    // Cells outside the touched span are blank, and are not read so as not
+    // to fault in pages for them
+    std::size_t begin = head_ - width / 2;
+    for (int i = 0; i < width; ++i) {
+        std::size_t cell = begin + i;
+        if (cell < left_ || cell > right_)
+            waddch(win, BLANK);
+        else
+            waddch(win, cells_[cell] ^ BLANK);
+    }
 }
@@ -2,86 +2,155 @@
 #define TAPE_HPP
 
 #include <cstddef>
+#include <cstdint>
+#include <curses.h>
 
 constexpr char BLANK = '~';
 
+/** The address space reserved for a tape. Only the pages the machine
+ * touches are ever committed, so this may be far larger than the memory of
+ * the system
+ */
+#ifdef TAPE_RESERVE_BYTES
+constexpr std::size_t TAPE_RESERVE = TAPE_RESERVE_BYTES;
+#else
+constexpr std::size_t TAPE_RESERVE = (std::size_t)1 << 40;
+#endif /* TAPE_RESERVE_BYTES */
+
+/** Although the tape should theoretically be infinite, we have to limit the
+ * memory it commits in order to prevent an infinite loop from consuming all
+ * of the system's memory
+ */
+#ifdef MAX_TAPE_BYTES
+constexpr std::size_t TAPE_BUDGET = MAX_TAPE_BYTES;
+#else
+constexpr std::size_t TAPE_BUDGET = (std::size_t)1 << 30;
+#endif /* MAX_TAPE_BYTES */
+
 /** @class Tape
  * This class implements the infinite tape component of the Turing machine
- * (although obviously the storage in this class is finite)
+ * as one byte per cell in a large anonymous mapping, with the head starting
+ * in the middle. Cells are stored XORed with BLANK so that the zero-filled
+ * pages the kernel commits on first touch read as blank, and no growth is
+ * ever needed. Define TAPE_HUGE_PAGES to back the tape with transparent huge
+ * pages
  */
 class Tape {
-    /** @struct Cell
-     * Doubly-linked list representation of an infinite tape. The ends
-     * always have sym = BLANK and link to themselves
+    /** The start of the mapping */
+    std::uint8_t* cells_;
+
+    /** The size of the mapping, which may be less than TAPE_RESERVE if the
+     * system refused to reserve that much
      */
-    struct Cell {
-        /** The symbol written on this cell */
-        char sym;
+    std::size_t reserved_;
 
-        /** Links to the previous and next nodes in the list */
-        Cell *prev, *next;
+    /** The index of the cell under the head */
+    std::size_t head_;
 
-        /** Creates a cell with the given symbol and links. If prev or next
-         * are nullptr, the cell is linked to itself to represent the
-         * infinite ends of the list
-         */
-        Cell(char sym, Cell *prev = nullptr, Cell *next = nullptr);
-    } *head_;
+    /** The indices of the leftmost and rightmost cells the head has been
+     * on since the tape was cleared; all cells outside are blank
+     */
+    std::size_t left_, right_;
 
-    /** The current number of cell nodes */
-    std::size_t size_;
+    /** The maximum number of bytes of committed pages */
+    std::size_t budget_;
 
-    /** Duplicates the cell to the left of the head in order to grow the
-     * empty space at the left end of the tape
-     * @return True if there is an error (i.e., out of memory), false
-     * otherwise
-     */
-    bool duplicateLeft();
+    /** The granularity with which the kernel commits pages */
+    std::size_t page_;
 
-    /** Duplicates the cell to the right of the head in order to grow the
-     * empty space at the right end of the tape
-     * @return True if there is an error (i.e., out of memory), false
-     * otherwise
+    /** Whether a move was refused for exceeding the budget */
+    bool exhausted_;
+
+    /** Returns the bytes of the pages spanning the cells from left to
+     * right
      */
-    bool duplicateRight();
+    std::size_t span(std::size_t left, std::size_t right) const;
 
-    /** Prints n cells to the left of the given cell to win */
-    void printLeft(WINDOW* win, Cell *cell, int n);
+    /** Accounts for the head having moved left of the touched span
+     * @return True if the move would exceed the budget, in which case it is
+     * undone, false otherwise
+     */
+    bool extendLeft();
 
-    /** Prints n cells to the right of the given cell to win */
-    void printRight(WINDOW* win, Cell *cell, int n);
+    /** Accounts for the head having moved right of the touched span
+     * @return True if the move would exceed the budget, in which case it is
+     * undone, false otherwise
+     */
+    bool extendRight();
 
 public:
-    Tape();
+    /** @param budget The maximum number of bytes the tape may commit */
+    explicit Tape(std::size_t budget = TAPE_BUDGET);
     ~Tape();
 
+    Tape(const Tape&) = delete;
+    Tape& operator=(const Tape&) = delete;
+
     /** Moves the head of the tape to the left
      * @return True if there is an error (i.e., out of memory), false
      * otherwise
      */
-    bool moveLeft();
+    bool moveLeft()
+    {
+        // Compared before the move, since head_ wraps around at index 0
+        return head_-- <= left_ && extendLeft();
+    }
 
     /** Moves the head of the tape to the right
      * @return True if there is an error (i.e., out of memory), false
      * otherwise
      */
-    bool moveRight();
+    bool moveRight()
+    {
+        return ++head_ > right_ && extendRight();
+    }
 
-    /** Clears the tape to all blanks */
+    /** Clears the tape to all blanks, releasing its committed pages, and
+     * returns the head to the middle
+     */
     void clear();
 
     /** Sets the symbol under the head
      * @return True if there is an error (i.e., out of memory), false
      * otherwise
      */
-    bool writeHead(char sym);
+    bool writeHead(char sym)
+    {
+        cells_[head_] = sym ^ BLANK;
+        return false;
+    }
 
     /** Returns the symbol currently under the head */
-    char readHead();
+    char readHead() const
+    {
+        return cells_[head_] ^ BLANK;
+    }
+
+    /** Returns the position of the head relative to where it was when the
+     * tape was cleared
+     */
+    long position() const
+    {
+        return (long)head_ - (long)(reserved_ / 2);
+    }
+
+    /** Sets the maximum number of bytes the tape may commit. Cells already
+     * touched stay usable even if they exceed it
+     */
+    void setBudget(std::size_t budget);
+
+    /** Sets the budget to the bytes of the most pages the given number of
+     * contiguous cells can span, so that the head may visit at least that
+     * many cells whichever way it goes
+     */
+    void setCellBudget(std::size_t cells);
+
+    /** Returns the bytes of memory committed to the touched cells */
+    std::size_t committed() const;
 
-    /** Returns whether this tape has allocated all of its available cell
-     * nodes. Note that it may still be usable so long no new cells need to
-     * be allocated
+    /** Returns whether the head was refused a move because the tape would
+     * exceed its budget. Note that it may still be usable so long as the
+     * head stays on cells it has already touched
      */
     bool outOfMemory() const;
 
@@ -1,5 +1,11 @@
+#include <algorithm>
 #include "TuringCurses.hpp"
 
+/** How often to check for changes to the loaded files while waiting for a
+ * key, in milliseconds
+ */
+constexpr int RELOAD_INTERVAL = 250;
+
 TuringCurses::TuringCurses() : stdscr_(nullptr) {}
 
 TuringCurses::~TuringCurses()
@@ -24,11 +30,33 @@ void TuringCurses::initCurses()
     init_pair(1, COLOR_BLACK, COLOR_WHITE);
     init_pair(2, COLOR_WHITE, COLOR_GREEN);
     init_pair(3, COLOR_WHITE, COLOR_RED);
+    init_pair(4, COLOR_BLACK, COLOR_YELLOW);
 }
 
 bool TuringCurses::addStates(const char* filename)
 {
-    return machine_.parser().addStates(filename);
+    return addStates(1, &filename);
+}
+
+bool TuringCurses::addStates(int num, const char* filenames[])
+{
+    files_.assign(filenames, filenames + num);
+    return machine_.parser().addStates(num, filenames);
+}
+
+bool TuringCurses::addStates(const Program& program, const char* name)
+{
+    return machine_.parser().addStates(program, name);
+}
+
+OptimizerReport TuringCurses::optimize()
+{
+    return machine_.optimize();
+}
+
+void TuringCurses::setTapeCells(std::size_t cells)
+{
+    machine_.setTapeCells(cells);
 }
 
 void TuringCurses::drawScreen()
@@ -38,9 +66,8 @@ void TuringCurses::drawScreen()
     wrefresh(status_);
 }
 
-void TuringCurses::readInput()
+std::string TuringCurses::readLine(const std::string& prompt)
 {
-    static const std::string prompt("Input? ");
     std::string input;
     int c;
     writeStatus(prompt.c_str());
@@ -59,10 +86,39 @@ void TuringCurses::readInput()
         else if (c == KEY_RIGHT && (unsigned)x < input.size() + prompt.size())
             wmove(status_, y, x + 1);
     }
-    machine_.write(input.c_str());
+    return input;
+}
+
+void TuringCurses::readInput()
+{
+    machine_.write(readLine("Input? ").c_str());
     writeStatus("Machine is idle");
 }
 
+void TuringCurses::readBreakpoint()
+{
+    std::string spec = readLine("Break on (state L, rule L S, write S, step N,"
+                                " left P, right P)? ");
+    if (machine_.addBreakpoint(spec))
+        writeStatus(("Invalid breakpoint `" + spec + "'").c_str());
+    else
+        writeStatus(("Breakpoint added on " + spec).c_str());
+}
+
+void TuringCurses::reloadChanged()
+{
+    for (const std::string& file : watcher_.changed()) {
+        if (machine_.reload(file.c_str())) {
+            std::string message = err.str();
+            message.erase(std::min(message.find('\n'), message.size()));
+            writeStatus(("Reload failed: " + message).c_str());
+            err.str("");
+            err.clear();
+        } else
+            writeStatus(("Reloaded " + file).c_str());
+    }
+}
+
 void TuringCurses::updateSize()
 {
     werase(stdscr_);
@@ -81,6 +137,15 @@ void TuringCurses::writeStatus(const char* message)
 
 int TuringCurses::main()
 {
+    // Optimized states no longer match the files, so they are not reloaded
+    if (machine_.parser().reloadable()) {
+        bool watching = false;
+        for (const std::string& file : files_)
+            watching |= !watcher_.watch(file);
+        if (watching)
+            wtimeout(stdscr_, RELOAD_INTERVAL);
+    }
+
     drawScreen();
     readInput();
 
@@ -93,17 +158,28 @@ int TuringCurses::main()
             break;
         else if (c == KEY_RESIZE)
             updateSize();
+        else if (c == ERR) {
+            reloadChanged();
+            continue;
+        }
 
         int result = 0;
         if (c == 'n')
             result = machine_.step();
         else if (c == '\n') {
-            result = 1;
-            if (machine_.run() < 0)
-                result = -1;
+            result = machine_.run();
+            if (result == 0)
+                result = 1;
         } else if (c == 'i') {
             readInput();
             continue;
+        } else if (c == 'b') {
+            readBreakpoint();
+            continue;
+        } else if (c == 'c') {
+            machine_.clearBreakpoints();
+            writeStatus("Breakpoints cleared");
+            continue;
         } else
             continue;
         if (result < 0) {
@@ -115,6 +191,12 @@ int TuringCurses::main()
             drawScreen();
             wgetch(status_);
             readInput();
+        } else if (result == BREAK) {
+            std::string status = "Breakpoint hit at step " +
+                                 std::to_string(machine_.steps()) +
+                                 ", head at " +
+                                 std::to_string(machine_.position());
+            writeStatus(status.c_str());
         } else if (result > 0) {
             if (!machine_.accepting())
                 writeStatus("Machine jammed");
@@ -1,15 +1,32 @@
 #ifndef TURING_CURSES_HPP
 #define TURING_CURSES_HPP
 
+#include <string>
+#include <vector>
+#include "FileWatcher.hpp"
 #include "TuringMachine.hpp"
 
 class TuringCurses {
     TuringMachine machine_;
+
+    /** The files the machine was loaded from */
+    std::vector<std::string> files_;
+
+    FileWatcher watcher_;
     WINDOW *stdscr_, *status_;
     int height_, width_;
 
     void drawScreen();
+    /** Prompts for a line of text on the status line */
+    std::string readLine(const std::string& prompt);
+
     void readInput();
+
+    /** Prompts for a breakpoint and adds it to the machine */
+    void readBreakpoint();
+
+    /** Reloads the files that changed since the last call */
+    void reloadChanged();
     void updateSize();
     void writeStatus(const char* message);
 
@@ -21,6 +38,14 @@ public:
 
     bool addStates(const char* filename);
 
+    bool addStates(int num, const char* filenames[]);
+
+    bool addStates(const Program& program, const char* name);
+
+    OptimizerReport optimize();
+
+    void setTapeCells(std::size_t cells);
+
     int main();
 };
 
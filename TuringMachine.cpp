@@ -1,13 +1,37 @@
+#include <algorithm>
 #include <sstream>
 #include "TuringMachine.hpp"
 
-TuringMachine::TuringMachine() : stopped_(false) {}
+Breakpoints::Breakpoints() : step(0), left(LONG_MIN), right(LONG_MAX) {}
+
+void Breakpoints::clear()
+{
+    *this = Breakpoints();
+}
+
+TuringMachine::TuringMachine() : stopped_(false), steps_(0) {}
 
 StateParser& TuringMachine::parser()
 {
     return register_.parser();
 }
 
+OptimizerReport TuringMachine::optimize()
+{
+    OptimizerReport report = StateOptimizer(register_).optimize();
+    markBreakpoints();
+    return report;
+}
+
+bool TuringMachine::reload(const char* filename)
+{
+    if (register_.parser().reload(filename))
+        return true;
+    markBreakpoints();
+    stopped_ = false;
+    return false;
+}
+
 void TuringMachine::write(const char* str)
 {
     int n = 0;
@@ -21,6 +45,7 @@ void TuringMachine::write(const char* str)
     while (n--)
         tape_.moveLeft();
     stopped_ = false;
+    steps_ = 0;
     register_.reset();
 }
 
@@ -29,6 +54,7 @@ int TuringMachine::step()
     int r = register_.handle(tape_.readHead());
     if ((stopped_ = (r < 0))) // Intentional assignment
         return 1;
+    ++steps_;
     if (tape_.writeHead(r >> 8))
         return -1;
     if ((r & 0xFF) == 'L') {
@@ -38,14 +64,111 @@ int TuringMachine::step()
         if (tape_.moveRight())
             return -1;
     }
-    return 0;
+    return (r & BREAKPOINT) ? BREAK : 0;
+}
+
+std::uint64_t TuringMachine::untilBreakpoint() const
+{
+    std::uint64_t n = UINT64_MAX;
+    long pos = tape_.position();
+    // Conditions that already hold are passed over until they stop holding
+    if (breakpoints_.step > steps_)
+        n = breakpoints_.step - steps_;
+    if (breakpoints_.left != LONG_MIN && pos > breakpoints_.left)
+        n = std::min<std::uint64_t>(n, pos - breakpoints_.left);
+    if (breakpoints_.right != LONG_MAX && pos < breakpoints_.right)
+        n = std::min<std::uint64_t>(n, breakpoints_.right - pos);
+    return n;
 }
 
 int TuringMachine::run()
 {
     int r;
-    do {} while (!(r = step()));
-    return (r < 0) ? r : !register_.onFinal();
+    do {
+        std::uint64_t start = steps_, n = untilBreakpoint();
+        long pos = tape_.position();
+        for (; n; --n) {
+            if ((r = step()))
+                return (r == 1) ? !register_.onFinal() : r;
+        }
+        if ((start < breakpoints_.step && steps_ == breakpoints_.step) ||
+            (pos > breakpoints_.left &&
+             tape_.position() == breakpoints_.left) ||
+            (pos < breakpoints_.right &&
+             tape_.position() == breakpoints_.right))
+        {
+            return BREAK;
+        }
+    } while (true);
+}
+
+void TuringMachine::markBreakpoints()
+{
+    register_.clearBreakpoints();
+    for (const std::string& label : breakpoints_.states)
+        register_.breakOnState(label);
+    for (const std::pair<std::string, char>& rule : breakpoints_.rules)
+        register_.breakOnRule(rule.first, rule.second);
+    for (char sym : breakpoints_.writes)
+        register_.breakOnWrite(sym);
+}
+
+bool TuringMachine::addBreakpoint(const std::string& spec)
+{
+    std::istringstream ss(spec);
+    std::string kind, label;
+    char sym = 0;
+    long n = 0;
+    ss >> kind;
+    if (kind == "state")
+        ss >> label;
+    else if (kind == "rule")
+        ss >> label >> sym;
+    else if (kind == "write")
+        ss >> sym;
+    else if (kind == "step" || kind == "left" || kind == "right")
+        ss >> n;
+    else
+        return true;
+    if (ss.fail() || !(ss >> std::ws).eof())
+        return true;
+
+    if (kind == "state") {
+        if (register_.breakOnState(label))
+            return true;
+        breakpoints_.states.push_back(label);
+    } else if (kind == "rule") {
+        if (register_.breakOnRule(label, sym))
+            return true;
+        breakpoints_.rules.emplace_back(label, sym);
+    } else if (kind == "write") {
+        register_.breakOnWrite(sym);
+        breakpoints_.writes += sym;
+    } else if (kind == "step") {
+        if (n <= 0)
+            return true;
+        breakpoints_.step = n;
+    } else if (kind == "left")
+        breakpoints_.left = n;
+    else
+        breakpoints_.right = n;
+    return false;
+}
+
+void TuringMachine::clearBreakpoints()
+{
+    breakpoints_.clear();
+    register_.clearBreakpoints();
+}
+
+std::uint64_t TuringMachine::steps() const
+{
+    return steps_;
+}
+
+long TuringMachine::position() const
+{
+    return tape_.position();
 }
 
 bool TuringMachine::accepting() const
@@ -53,6 +176,11 @@ bool TuringMachine::accepting() const
     return register_.onFinal();
 }
 
+void TuringMachine::setTapeCells(std::size_t cells)
+{
+    tape_.setCellBudget(cells);
+}
+
 bool TuringMachine::outOfMemory() const
 {
     return tape_.outOfMemory();
@@ -77,33 +205,43 @@ void TuringMachine::printTape(WINDOW* win, int width)
     waddch(win, ACS_LRCORNER);
 }
 
-void TuringMachine::printTranscript(WINDOW* win, int width)
+void TuringMachine::printTranscript(WINDOW* win, int width, int height)
 {
-    std::istringstream ss(register_.transcript());
-    std::string line;
-    do {
-        getline(ss, line);
-        if (ss.eof())
-            break;
+    const StateParser& parser = register_.parser();
+    std::size_t lines = parser.lines(), rows = height > 0 ? height : 0;
+
+    // Center the view on the current state, but keep it filled when the
+    // state is near either end of the transcript
+    std::size_t current = register_.getLine(), first = 0;
+    if (lines > rows) {
+        first = current > rows / 2 ? current - rows / 2 : 0;
+        first = std::min(first, lines - rows);
+    }
+    const Action* next = stopped_ ? nullptr
+                                  : register_.find(tape_.readHead());
+
+    for (std::size_t row = 0; row < rows; ++row) {
+        std::size_t n = first + row, length = 0;
+        const char* str = nullptr;
+        if (n < lines)
+            str = parser.line(n, length);
 
         int color = 0;
-        if (line.substr(0, line.find(':')) == register_.getState())
+        if (str && n == current)
             color = stopped_ ? (accepting() ? 2 : 3) : 1;
+        else if (next && n == next->line)
+            color = 4;
         if (color)
-            attron(COLOR_PAIR(color));
+            wattron(win, COLOR_PAIR(color));
 
         int i;
-        const char* str = line.c_str();
-        for (i = 0; i < width; ++i) {
-            if (!*str)
-                break;
-            waddch(win, *str++);
-        }
+        for (i = 0; i < width && (std::size_t)i < length; ++i)
+            waddch(win, str[i]);
         for (; i < width; ++i)
             waddch(win, ' ');
         if (color)
-            attroff(COLOR_PAIR(color));
-    } while (true);
+            wattroff(win, COLOR_PAIR(color));
+    }
 }
 
 void TuringMachine::print(WINDOW* win)
@@ -112,6 +250,6 @@ void TuringMachine::print(WINDOW* win)
     getmaxyx(win, y, x);
     y = 1;
     printTape(win, x);
-    printTranscript(win, x);
+    printTranscript(win, x, getmaxy(win) - 4);
     wmove(win, y, x / 2);
 }
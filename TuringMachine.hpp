@@ -1,10 +1,50 @@
 #ifndef TURING_MACHINE_HPP
 #define TURING_MACHINE_HPP
 
+#include <climits>
+#include <cstdint>
 #include <curses.h>
+#include <string>
+#include <utility>
+#include <vector>
+#include "StateOptimizer.hpp"
 #include "StateRegister.hpp"
 #include "Tape.hpp"
 
+/** Returned by TuringMachine::step() and run() when a breakpoint was hit */
+constexpr int BREAK = 2;
+
+/** @struct Breakpoints
+ * The conditions on which TuringMachine::run() stops early. Conditions on
+ * rules are compiled into the register's actions, so they cost nothing
+ * until one hits. Conditions on the step count and head position split the
+ * run into chunks that are too short to reach them, so they are only
+ * checked between chunks
+ */
+struct Breakpoints {
+    /** Labels of states whose entry is a breakpoint */
+    std::vector<std::string> states;
+
+    /** Labels and symbols of rules whose execution is a breakpoint */
+    std::vector<std::pair<std::string, char>> rules;
+
+    /** Symbols whose writing is a breakpoint */
+    std::string writes;
+
+    /** The step count to stop at, or zero */
+    std::uint64_t step;
+
+    /** The head positions at or beyond which to stop, or LONG_MIN and
+     * LONG_MAX
+     */
+    long left, right;
+
+    Breakpoints();
+
+    /** Removes all conditions */
+    void clear();
+};
+
 class TuringMachine {
     /** The register of states */
     StateRegister register_;
@@ -17,14 +57,45 @@ class TuringMachine {
      */
     bool stopped_;
 
+    /** The number of steps executed since the input was written */
+    std::uint64_t steps_;
+
+    Breakpoints breakpoints_;
+
+    /** Marks the actions of the register for the rule conditions of
+     * breakpoints_
+     */
+    void markBreakpoints();
+
+    /** Returns the number of steps that may be executed before a step or
+     * head position breakpoint can hit
+     */
+    std::uint64_t untilBreakpoint() const;
+
     void printTape(WINDOW* win, int width);
-    void printTranscript(WINDOW* win, int width);
+
+    /** Prints as many rows of the transcript as fit in the given height,
+     * centered on the current state, with the rule that will handle the
+     * symbol under the head highlighted. Only the visible lines are read,
+     * so the cost does not depend on the size of the program
+     */
+    void printTranscript(WINDOW* win, int width, int height);
 
 public:
     TuringMachine();
 
     StateParser& parser();
 
+    /** Runs the optimizer over the loaded program; @see StateOptimizer */
+    OptimizerReport optimize();
+
+    /** Reloads one of the files the machine was loaded from, keeping the
+     * tape and, if it still exists, the current state; @see
+     * StateParser::reload()
+     * @return True on failure, false on success
+     */
+    bool reload(const char* filename);
+
     /** Clears the tape and writes the given string to it, positioning the
      * head at the front of the string
      * @param str Null-terminated string containing only human-readable
@@ -34,20 +105,53 @@ public:
 
     /** Executes one action based on the current state and the symbol under
      * the head
-     * @return Zero if an action executed successfully, positive if no
-     * applicable action was found, and negative if there was an error
+     * @return Zero if an action executed successfully, BREAK if the action
+     * was a breakpoint, one if no applicable action was found, and negative
+     * if there was an error
      */
     int step();
 
-    /** Executes actions until another action can no longer be handled
-     * @return Zero if execution completed on a final state, positive if the
-     * machine jammed, and negative if there was an error
+    /** Executes actions until another action can no longer be handled or a
+     * breakpoint is hit
+     * @return Zero if execution completed on a final state, one if the
+     * machine jammed, BREAK if a breakpoint was hit, and negative if there
+     * was an error
      */
     int run();
 
+    /** Adds a breakpoint described by one of
+     *
+     *   state LABEL      entering the state
+     *   rule LABEL SYM   executing the rule of the state for the symbol
+     *   write SYM        writing the symbol
+     *   step N           reaching step N
+     *   left POS         the head reaching position POS or further left
+     *   right POS        the head reaching position POS or further right
+     *
+     * where positions are relative to the start of the input
+     * @return True if the description is invalid, false otherwise
+     */
+    bool addBreakpoint(const std::string& spec);
+
+    /** Removes all breakpoints */
+    void clearBreakpoints();
+
+    /** Returns the number of steps executed since the input was written */
+    std::uint64_t steps() const;
+
+    /** Returns the position of the head relative to the start of the
+     * input
+     */
+    long position() const;
+
     /** Whether this machine is in an accepting (a.k.a. final) state */
     bool accepting() const;
 
+    /** Limits the tape to about the given number of cells; @see
+     * Tape::setCellBudget()
+     */
+    void setTapeCells(std::size_t cells);
+
     /** Whether the tape is out of memory; @see Tape::outOfMemory() */
     bool outOfMemory() const;
 
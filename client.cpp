@@ -0,0 +1,106 @@
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <unistd.h>
+#include "Socket.hpp"
+
+static void usage(const char* name)
+{
+    std::cerr << "Usage: " << name
+              << " [-l STEPS] [-s CELLS] SOCKET FILE INPUT" << std::endl
+              << "       " << name
+              << " [-l STEPS] [-s CELLS] -i PROGRAM SOCKET INPUT"
+              << std::endl
+              << "  -i  run a program the server compiled for an earlier"
+              << " request" << std::endl
+              << "  -l  maximum number of steps (default: server maximum)"
+              << std::endl
+              << "  -s  maximum number of tape cells (default: server maximum)"
+              << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned long long steps = 0, cells = 0;
+    const char* program = nullptr;
+    int opt;
+    while ((opt = getopt(argc, argv, "i:l:s:")) != -1) {
+        switch (opt) {
+        case 'i':
+            program = optarg;
+            break;
+        case 'l':
+            steps = std::strtoull(optarg, nullptr, 10);
+            break;
+        case 's':
+            cells = std::strtoull(optarg, nullptr, 10);
+            break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (argc - optind != (program ? 2 : 3)) {
+        usage(argv[0]);
+        return 1;
+    }
+    const char* path = argv[optind];
+    std::string input = argv[argc - 1];
+
+    std::ostringstream request;
+    if (program) {
+        request << "RUN " << program << ' ' << steps << ' ' << cells << ' '
+                << input.size() << '\n' << input;
+    } else {
+        const char* filename = argv[optind + 1];
+        std::ifstream file(filename);
+        if (!file.is_open()) {
+            std::cerr << filename << ": No such file" << std::endl;
+            return 1;
+        }
+        std::stringstream source;
+        source << file.rdbuf();
+        request << "EXEC " << steps << ' ' << cells << ' '
+                << source.str().size() << ' ' << input.size() << '\n'
+                << source.str() << input;
+    }
+
+    int fd = connectUnix(path);
+    if (fd < 0) {
+        std::cerr << path << ": " << std::strerror(errno) << std::endl;
+        return 1;
+    }
+    SocketStream stream(fd);
+    std::string header, id, outcome, state, payload;
+    unsigned long long count, size;
+    // The server answers a request it refuses before reading all of it,
+    // so the answer is read even if the request could not be written
+    stream.write(request.str());
+    if (stream.readLine(header)) {
+        std::cerr << path << ": Connection lost" << std::endl;
+        return 1;
+    }
+    std::istringstream response(header);
+    response >> outcome;
+    if (outcome == "ERROR") {
+        response >> size;
+        stream.read(size, payload);
+        std::cerr << payload;
+        return 1;
+    }
+    if (!(response >> id >> outcome >> count >> state >> size) ||
+        stream.read(size, payload))
+    {
+        std::cerr << path << ": Malformed response" << std::endl;
+        return 1;
+    }
+    std::cout << "Program: " << id << std::endl
+              << "Outcome: " << outcome << std::endl
+              << "Steps:   " << count << std::endl
+              << "State:   " << state << std::endl
+              << "Tape:    " << payload << std::endl;
+    return 0;
+}
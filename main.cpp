@@ -1,15 +1,506 @@
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
 #include <iostream>
+#include <memory>
+#include <unistd.h>
+#include <vector>
+#include "BatchEngine.hpp"
+#include "BusyBeaver.hpp"
+#include "Diagram.hpp"
+#include "JobServer.hpp"
+#include "MachineDatabase.hpp"
+#include "Parallel.hpp"
+#include "PerfCounters.hpp"
+#include "ProcessPool.hpp"
+#include "ResultCache.hpp"
+#include "Runner.hpp"
+#include "StateLayout.hpp"
 #include "TuringCurses.hpp"
 
-int main(int argc, const char *argv[])
+static void usage(const char* name)
 {
-    if (argc < 2) {
-        std::cerr << "Usage: " << argv[0] << " FILE" << std::endl;
+    std::cerr << "Usage: " << name << " [-O] [-s CELLS] FILE..." << std::endl
+              << "       " << name << " [-O] [-s CELLS] -c MACHINE"
+              << std::endl
+              << "       " << name
+              << " -r INPUT [-O] [-l STEPS] [-s CELLS] [-C DIR] [-P BATCH]"
+              << " (-c MACHINE | FILE...)" << std::endl
+              << "       " << name
+              << " -r INPUT -T IMAGE [-O] [-l STEPS] [-s CELLS] [-g COLSxROWS]"
+              << " [-z STEPSxCELLS]" << std::endl
+              << "           (-c MACHINE | FILE...)" << std::endl
+              << "       " << name
+              << " -R INPUTS [-O] [-l STEPS] [-s CELLS] [-C DIR] [-j THREADS]"
+              << " (-c MACHINE | FILE...)" << std::endl
+              << "       " << name
+              << " -R INPUTS -F PROCESSES [-m MEGABYTES] [-O] [-l STEPS]"
+              << " [-s CELLS] [-C DIR]" << std::endl
+              << "           (-c MACHINE | FILE...)" << std::endl
+              << "       " << name
+              << " -t INPUT [-O] [-l STEPS] [-s CELLS] (-c MACHINE | FILE...)"
+              << std::endl
+              << "       " << name
+              << " -S SOCKET [-O] [-l STEPS] [-s CELLS] [-C DIR] [-j THREADS]"
+              << std::endl
+              << "       " << name
+              << " -b STATESxSYMBOLS [-l STEPS] [-s CELLS] [-d DEPTH]"
+              << " [-j THREADS] [-P 0]" << std::endl
+              << "       " << name
+              << " -D DATABASE [-b STATESxSYMBOLS] [-l STEPS] [-s CELLS]"
+              << " [-d DEPTH] [-j THREADS] [-P 0]" << std::endl
+              << "  -O  optimize the program and report what was removed"
+              << std::endl
+              << "  -c  load a machine in compact notation"
+              << " (e.g. 1RB1LB_1LA1RZ)"
+              << std::endl
+              << "  -r  run on the given input without the user interface"
+              << std::endl
+              << "  -R  run on each line of a file (- for standard input),"
+              << " printing one line" << std::endl
+              << "      per input" << std::endl
+              << "  -T  draw the run as a space-time diagram in a PGM image"
+              << std::endl
+              << "  -g  largest size of the diagram (default: 1024x1024)"
+              << std::endl
+              << "  -z  steps per row and cells per column to start the"
+              << " diagram with; both" << std::endl
+              << "      double as needed to fit the run (default: 1x1)"
+              << std::endl
+              << "  -t  run on the given input, counting transitions, and"
+              << " print a layout of" << std::endl
+              << "      the states that keeps the ones that run together"
+              << " close in memory" << std::endl
+              << "  -L  lay the states out as in a file printed by -t for"
+              << " -r, -R and -T" << std::endl
+              << "  -F  run -R in the given number of worker processes,"
+              << " restarting any that" << std::endl
+              << "      crash; their inputs are reported as crashed"
+              << std::endl
+              << "  -m  kill workers whose resident memory exceeds the given"
+              << " megabytes" << std::endl
+              << "  -S  serve run requests on a Unix domain socket"
+              << std::endl
+              << "  -b  enumerate busy beaver machines, printing holdouts"
+              << std::endl
+              << "  -D  classify the machines of a database, printing holdouts"
+              << " (default size: 5x2)" << std::endl
+              << "  -l  maximum number of steps; for -b and -D, steps before a"
+              << " machine is" << std::endl
+              << "      handed to the deciders" << std::endl
+              << "  -s  maximum number of tape cells" << std::endl
+              << "  -C  reuse the results of earlier runs cached in the"
+              << " given directory" << std::endl
+              << "  -d  depth limit for backward reasoning" << std::endl
+              << "  -j  number of threads (default: all cores)" << std::endl
+              << "  -P  report hardware performance counters to stderr, and"
+              << " for -r, per batch" << std::endl
+              << "      of the given number of steps as well (0: only the"
+              << " totals)" << std::endl;
+}
+
+static int busyBeaver(const BusyBeaverConfig& config, const char* database,
+                      bool profile)
+{
+    BusyBeaverStats stats;
+    // Counters are opened on every thread the run spawns, so only when asked
+    std::unique_ptr<PerfCounters> counters;
+    if (profile) {
+        counters.reset(new PerfCounters);
+        counters->start();
+    }
+    if (database) {
+        MachineDatabase db(config.states, config.symbols);
+        if (db.open(database)) {
+            std::cerr << err.str();
+            return 1;
+        }
+        stats = db.classify(config);
+    } else
+        stats = BusyBeaver(config).run();
+    PerfSample sample;
+    if (profile)
+        sample = counters->read();
+    for (const std::string& holdout : stats.holdouts)
+        std::cout << holdout << '\n';
+    stats.print(std::cerr);
+    if (profile)
+        sample.print(std::cerr, stats.enumerated, "machine");
+    return 0;
+}
+
+/** Compiles the machine given on the command line
+ * @return True on failure (with diagnostics printed), false on success
+ */
+static bool loadProgram(const char* compact, int num, const char* filenames[],
+                        bool optimize, Program& program)
+{
+    bool failed;
+    if (compact) {
+        failed = fromCompact(compact, program);
+        if (!failed && optimize) {
+            StateRegister reg;
+            failed = reg.parser().addStates(program, compact);
+            if (!failed) {
+                StateOptimizer(reg).optimize().print(std::cerr);
+                program = Program(reg);
+            }
+        }
+    } else {
+        OptimizerReport report;
+        failed = compileFiles(num, filenames, optimize, program, &report);
+        if (!failed)
+            report.print(std::cerr);
+    }
+    if (failed)
+        std::cerr << err.str();
+    return failed;
+}
+
+/** Runs the program on the input, or looks the result up in results if it
+ * is not nullptr and the run is not profiled
+ */
+static int headless(const Program& program, const std::string& input,
+                    const RunLimits& limits, bool profile,
+                    std::uint64_t batch, ResultCache* results)
+{
+    RunResult result;
+    if (profile)
+        result = profileProgram(program, input, limits, batch, std::cerr);
+    else if (!results)
+        result = runProgram(program, input, limits);
+    else {
+        std::uint64_t digest = ResultCache::digest(program);
+        if (results->find(digest, input, limits, result)) {
+            result = runProgram(program, input, limits);
+            results->store(digest, input, limits, result);
+        }
+    }
+    result.print(std::cout);
+    return 0;
+}
+
+/** Runs the machine in the given files on the input, compiling it only if
+ * the run is long (@see runTiered()), and prints the steps of each tier to
+ * stderr
+ */
+static int tiered(int num, const char* filenames[], bool optimize,
+                  const std::string& input, const RunLimits& limits)
+{
+    StateRegister reg;
+    OptimizerReport report;
+    if (parseFiles(num, filenames, optimize, reg, &report)) {
+        std::cerr << err.str();
+        return 1;
+    }
+    report.print(std::cerr);
+    TierSteps tiers;
+    runTiered(reg, input, limits, tiers).print(std::cout);
+    tiers.print(std::cerr);
+    return 0;
+}
+
+/** Runs the program on the input, drawing the run into an image at path */
+static int draw(const Program& program, const std::string& input,
+                const RunLimits& limits, const char* path,
+                std::uint32_t width, std::uint32_t height,
+                std::uint64_t interval, std::uint64_t cellsPerColumn)
+{
+    SpaceTimeDiagram diagram(program, width, height, interval,
+                             cellsPerColumn);
+    RunResult result = drawProgram(program, input, limits, diagram);
+    if (diagram.write(path)) {
+        std::cerr << err.str();
         return 1;
     }
+    result.print(std::cout);
+    return 0;
+}
+
+/** Runs the program on every input, on the given number of threads of
+ * this process, or in a ProcessPool of the given number of worker
+ * processes if it is not zero
+ * @param maxMemory The most resident memory a worker may use in bytes, or
+ * zero for no limit
+ * @return True on failure (with diagnostics printed), false on success
+ */
+static bool runInputs(const Program& program,
+                      const std::vector<std::string>& inputs,
+                      const RunLimits& limits, unsigned threads,
+                      unsigned processes, std::size_t maxMemory,
+                      std::vector<RunResult>& ran)
+{
+    if (!processes) {
+        ran = runBatch(program, inputs, limits, threads);
+        return false;
+    }
+    ProcessPool pool(program, limits, processes, maxMemory);
+    if (pool.run(inputs, ran)) {
+        std::cerr << err.str();
+        return true;
+    }
+    if (pool.restarts() || pool.kills()) {
+        std::cerr << "Workers restarted: " << pool.restarts()
+                  << " (killed for memory: " << pool.kills() << ")"
+                  << std::endl;
+    }
+    return false;
+}
+
+/** Runs the program on each line of the file at path (or of the standard
+ * input if path is "-"), printing one line per input. Only the inputs whose
+ * results are not in results (if it is not nullptr) are run, and results of
+ * runs that crashed are not cached
+ */
+static int batchRun(const Program& program, const char* path,
+                    const RunLimits& limits, unsigned threads,
+                    unsigned processes, std::size_t maxMemory,
+                    ResultCache* results)
+{
+    std::ifstream file;
+    if (std::string(path) != "-") {
+        file.open(path);
+        if (!file.is_open()) {
+            std::cerr << path << ": No such file" << std::endl;
+            return 1;
+        }
+    }
+    std::istream& stream = file.is_open() ? file : std::cin;
+    std::vector<std::string> inputs;
+    std::string line;
+    while (std::getline(stream, line))
+        inputs.push_back(line);
+    std::vector<RunResult> ran;
+    if (!results) {
+        if (runInputs(program, inputs, limits, threads, processes, maxMemory,
+                      ran))
+        {
+            return 1;
+        }
+        for (const RunResult& result : ran)
+            result.printLine(std::cout);
+        return 0;
+    }
+
+    std::uint64_t digest = ResultCache::digest(program);
+    std::vector<RunResult> found(inputs.size());
+    std::vector<std::size_t> missing;
+    std::vector<std::string> missed;
+    for (std::size_t i = 0; i < inputs.size(); ++i) {
+        if (results->find(digest, inputs[i], limits, found[i])) {
+            missing.push_back(i);
+            missed.push_back(inputs[i]);
+        }
+    }
+    if (runInputs(program, missed, limits, threads, processes, maxMemory,
+                  ran))
+    {
+        return 1;
+    }
+    for (std::size_t i = 0; i < missing.size(); ++i) {
+        if (ran[i].outcome != Outcome::Crashed)
+            results->store(digest, missed[i], limits, ran[i]);
+        found[missing[i]] = std::move(ran[i]);
+    }
+    for (const RunResult& result : found)
+        result.printLine(std::cout);
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    bool optimize = false, enumerate = false, profile = false;
+    const char *compact = nullptr, *database = nullptr, *input = nullptr;
+    const char *socket = nullptr, *inputs = nullptr, *cacheDir = nullptr;
+    const char *image = nullptr, *train = nullptr, *layout = nullptr;
+    std::uint32_t width = 1024, height = 1024;
+    std::uint64_t interval = 1, cellsPerColumn = 1;
+    unsigned processes = 0;
+    std::size_t maxMemory = 0;
+    std::uint64_t steps = 0, batch = 0;
+    std::size_t cells = 0;
+    BusyBeaverConfig config;
+    config.states = 5;
+    config.symbols = 2;
+    int opt;
+    const char* options = "Oc:r:R:S:C:T:g:z:t:L:F:m:b:D:l:s:d:j:P:";
+    while ((opt = getopt(argc, argv, options)) != -1) {
+        switch (opt) {
+        case 'O':
+            optimize = true;
+            break;
+        case 'c':
+            compact = optarg;
+            break;
+        case 'r':
+            input = optarg;
+            break;
+        case 'R':
+            inputs = optarg;
+            break;
+        case 'S':
+            socket = optarg;
+            break;
+        case 'C':
+            cacheDir = optarg;
+            break;
+        case 'T':
+            image = optarg;
+            break;
+        case 't':
+            train = optarg;
+            break;
+        case 'L':
+            layout = optarg;
+            break;
+        case 'F':
+            processes = std::strtoul(optarg, nullptr, 10);
+            break;
+        case 'm':
+            maxMemory = std::strtoull(optarg, nullptr, 10) << 20;
+            break;
+        case 'g':
+            if (std::sscanf(optarg, "%ux%u", &width, &height) != 2 ||
+                !width || !height)
+            {
+                std::cerr << argv[0] << ": Invalid diagram size `" << optarg
+                          << "'" << std::endl;
+                return 1;
+            }
+            break;
+        case 'z':
+            if (std::sscanf(optarg, "%" SCNu64 "x%" SCNu64, &interval,
+                            &cellsPerColumn) != 2 ||
+                !interval || !cellsPerColumn)
+            {
+                std::cerr << argv[0] << ": Invalid diagram scale `" << optarg
+                          << "'" << std::endl;
+                return 1;
+            }
+            break;
+        case 'D':
+            database = optarg;
+            break;
+        case 'b':
+            enumerate = true;
+            if (std::sscanf(optarg, "%ux%u", &config.states,
+                            &config.symbols) != 2 ||
+                config.states < 1 || config.states > 25 ||
+                config.symbols < 2 || config.symbols > 10)
+            {
+                std::cerr << argv[0] << ": Invalid machine size `" << optarg
+                          << "'" << std::endl;
+                return 1;
+            }
+            break;
+        case 'l':
+            steps = std::strtoull(optarg, nullptr, 10);
+            break;
+        case 's':
+            cells = std::strtoull(optarg, nullptr, 10);
+            break;
+        case 'd':
+            config.depth = std::strtoul(optarg, nullptr, 10);
+            break;
+        case 'j':
+            config.threads = std::strtoul(optarg, nullptr, 10);
+            break;
+        case 'P':
+            profile = true;
+            batch = std::strtoull(optarg, nullptr, 10);
+            break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (enumerate || database) {
+        if (steps)
+            config.steps = steps;
+        if (cells)
+            config.space = cells;
+        return busyBeaver(config, database, profile);
+    }
+
+    RunLimits limits;
+    if (steps)
+        limits.steps = steps;
+    if (cells)
+        limits.cells = cells;
+    std::unique_ptr<ResultCache> results;
+    if (cacheDir)
+        results.reset(new ResultCache(cacheDir));
+    if (socket) {
+        unsigned threads = config.threads ? config.threads : defaultThreads();
+        if (JobServer(socket, limits, threads, optimize, results.get()).run())
+        {
+            std::cerr << err.str();
+            return 1;
+        }
+        return 0;
+    }
+
+    if (!compact && optind >= argc) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (input && !compact && !inputs && !train && !image && !layout &&
+        !profile && !results)
+    {
+        return tiered(argc - optind, (const char**)argv + optind, optimize,
+                      input, limits);
+    }
+    if (input || inputs || train) {
+        Program program;
+        if (loadProgram(compact, argc - optind, (const char**)argv + optind,
+                        optimize, program))
+        {
+            return 1;
+        }
+        if (train) {
+            writeLayout(std::cout, program,
+                        planLayout(program,
+                                   countTransitions(program, train, limits)));
+            return 0;
+        }
+        if (layout) {
+            std::vector<std::uint32_t> order;
+            if (readLayout(layout, program, order)) {
+                std::cerr << err.str();
+                return 1;
+            }
+            program.renumber(order);
+        }
+        if (inputs) {
+            return batchRun(program, inputs, limits, config.threads,
+                            processes, maxMemory, results.get());
+        }
+        if (image) {
+            return draw(program, input, limits, image, width, height,
+                        interval, cellsPerColumn);
+        }
+        return headless(program, input, limits, profile, batch,
+                        results.get());
+    }
+
     TuringCurses curses;
-    if (curses.addStates(argv[1]))
+    bool failed;
+    if (compact) {
+        Program program;
+        failed = fromCompact(compact, program) ||
+                 curses.addStates(program, compact);
+    } else
+        failed = curses.addStates(argc - optind, (const char**)argv + optind);
+    if (failed) {
+        std::cerr << err.str();
         return 1;
+    }
+    if (optimize)
+        curses.optimize().print(std::cerr);
+    if (cells)
+        curses.setTapeCells(cells);
     curses.initCurses();
     curses.main();
 }